@@ -1,15 +1,14 @@
 #include "Body.h"
 #include "Extensions.h"
 
-#include "SDL/SDL_opengl.h"
-#include "gl/GLU.h"
-
 Body::
 Body(Emitter* emitter, const Vector2& position)
   : emitter(emitter),
-	position(position),
 	bodySize(20),
-	color({0, 0, 0, 255})
+	color({0, 0, 0, 255}),
+	mass(2000000),
+	position(position),
+	previousPosition(position)
 {
 	emitter->position = position;
 }
@@ -22,28 +21,44 @@ Body::
 
 void
 Body::
-update(float deltaTime)
+update()
 {
+	// the emitter still sits where the previous update left it
+	previousPosition = emitter->position;
     emitter->position = position;
-    emitter->update(deltaTime);
 }
 
-void
+Emitter* 
 Body::
-render()
+getEmitter()
 {
-	glPointSize(bodySize);
-	glBegin(GL_POINTS);
-		glColor4f(color.r / 255.0, color.g / 255.0, color.b / 255.0, color.a / 255.0);
-		glVertex2f(position.x, position.y);
-	glEnd();
+    return emitter;
+}
 
-	emitter->render();
+float
+Body::
+getSize()
+{
+	return bodySize;
 }
 
-Emitter* 
+SDL_Color
 Body::
-getEmitter()
+getColor()
 {
-    return emitter;
-}
\ No newline at end of file
+	return color;
+}
+
+void
+Body::
+setMass(float value)
+{
+	mass = value;
+}
+
+float
+Body::
+getMass()
+{
+	return mass;
+}
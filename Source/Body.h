@@ -9,17 +9,25 @@ private:
     Emitter* emitter;
 	float bodySize;
 	SDL_Color color;
+	float mass;
 
 public:
     Vector2 position;
 
+	// where the body was on the update before last
+	Vector2 previousPosition;
+
     Body(Emitter* emitter, const Vector2& position);
     ~Body();
 
-    void update(float deltaTime);
-
-	void render();
+	// Moves the emitter along with the body
+    void update();
 
     Emitter* getEmitter();
-};
+	float getSize();
+	SDL_Color getColor();
 
+	// Strength of the force the body exerts on particles, in px^3/s^2
+	void setMass(float value);
+	float getMass();
+};
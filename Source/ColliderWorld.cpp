@@ -0,0 +1,522 @@
+#include "ColliderWorld.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define COLLIDER_WORLD_SSE2
+#include <emmintrin.h>
+#endif
+
+const float ColliderWorld::SKIN = 0.01f;
+
+ColliderWorld::
+ColliderWorld()
+: dirty(false),
+  worldLeft(0),
+  worldTop(0),
+  worldRight(0),
+  worldBottom(0)
+{
+}
+
+void
+ColliderWorld::
+addSegment(const Vector2& from, const Vector2& to)
+{
+	segmentStarts.push_back(from);
+	segmentEnds.push_back(to);
+	dirty = true;
+}
+
+void
+ColliderWorld::
+addCircle(const Vector2& center, float radius)
+{
+	circleCenters.push_back(center);
+	circleRadii.push_back(std::max(radius, 0.0f));
+	dirty = true;
+}
+
+void
+ColliderWorld::
+addBox(const Vector2& topLeft, const Vector2& bottomRight)
+{
+	std::vector<Vector2> corners;
+	corners.push_back(topLeft);
+	corners.push_back(Vector2(bottomRight.x, topLeft.y));
+	corners.push_back(bottomRight);
+	corners.push_back(Vector2(topLeft.x, bottomRight.y));
+	addPolyline(corners, true);
+}
+
+void
+ColliderWorld::
+addPolyline(const std::vector<Vector2>& points, bool closed)
+{
+	for (int i = 1; i < (int)points.size(); ++i)
+		addSegment(points[i - 1], points[i]);
+	if (closed && points.size() > 2)
+		addSegment(points.back(), points.front());
+}
+
+void
+ColliderWorld::
+clear()
+{
+	segmentStarts.clear();
+	segmentEnds.clear();
+	circleCenters.clear();
+	circleRadii.clear();
+	dirty = true;
+}
+
+int
+ColliderWorld::
+getPrimitiveCount() const
+{
+	return (int)segmentStarts.size() + (int)circleCenters.size();
+}
+
+void
+ColliderWorld::
+prepare()
+{
+	if (dirty)
+		build();
+	dirty = false;
+}
+
+void
+ColliderWorld::
+build()
+{
+	nodes.clear();
+	leaves.clear();
+	segmentX.clear();
+	segmentY.clear();
+	segmentDX.clear();
+	segmentDY.clear();
+	segmentNX.clear();
+	segmentNY.clear();
+	circleX.clear();
+	circleY.clear();
+	circleRadius.clear();
+	circleRadius2.clear();
+	if (isEmpty())
+		return;
+
+	std::vector<Primitive> primitives;
+	for (int i = 0; i < (int)segmentStarts.size(); ++i)
+	{
+		const Vector2& a = segmentStarts[i];
+		const Vector2& b = segmentEnds[i];
+		Primitive primitive = { std::min(a.x, b.x), std::min(a.y, b.y), std::max(a.x, b.x), std::max(a.y, b.y), i, false };
+		primitives.push_back(primitive);
+	}
+
+	for (int i = 0; i < (int)circleCenters.size(); ++i)
+	{
+		const Vector2& c = circleCenters[i];
+		float r = circleRadii[i];
+		Primitive primitive = { c.x - r, c.y - r, c.x + r, c.y + r, i, true };
+		primitives.push_back(primitive);
+	}
+
+	worldLeft = primitives[0].left;
+	worldTop = primitives[0].top;
+	worldRight = primitives[0].right;
+	worldBottom = primitives[0].bottom;
+	for (std::vector<Primitive>::const_iterator p = primitives.begin(); p != primitives.end(); ++p)
+	{
+		worldLeft = std::min(worldLeft, p->left);
+		worldTop = std::min(worldTop, p->top);
+		worldRight = std::max(worldRight, p->right);
+		worldBottom = std::max(worldBottom, p->bottom);
+	}
+
+	nodes.resize(1);
+	split(primitives, 0, 0, (int)primitives.size());
+}
+
+void
+ColliderWorld::
+split(std::vector<Primitive>& primitives, int node, int begin, int end)
+{
+	// Halves the primitives, then halves the halves, into up to four
+	// children that are leaves once they hold LEAF_SIZE primitives or less
+	int ranges[5] = { begin, end };
+	int count = 1;
+	if (end - begin > LEAF_SIZE)
+	{
+		int halves[3] = { begin, divide(primitives, begin, end), end };
+		count = 0;
+		for (int half = 0; half < 2; ++half)
+		{
+			ranges[count++] = halves[half];
+			if (halves[half + 1] - halves[half] > LEAF_SIZE)
+				ranges[count++] = divide(primitives, halves[half], halves[half + 1]);
+		}
+		ranges[count] = end;
+	}
+
+	Node children;
+	for (int child = 0; child < 4; ++child)
+	{
+		children.left[child] = HUGE_VALF;
+		children.top[child] = HUGE_VALF;
+		children.right[child] = -HUGE_VALF;
+		children.bottom[child] = -HUGE_VALF;
+		children.children[child] = -1;
+		if (child >= count)
+			continue;
+
+		for (int i = ranges[child]; i < ranges[child + 1]; ++i)
+		{
+			children.left[child] = std::min(children.left[child], primitives[i].left);
+			children.top[child] = std::min(children.top[child], primitives[i].top);
+			children.right[child] = std::max(children.right[child], primitives[i].right);
+			children.bottom[child] = std::max(children.bottom[child], primitives[i].bottom);
+		}
+
+		if (ranges[child + 1] - ranges[child] <= LEAF_SIZE)
+		{
+			children.children[child] = ~addLeaf(primitives, ranges[child], ranges[child + 1]);
+		}
+		else
+		{
+			children.children[child] = (int)nodes.size();
+			nodes.resize(nodes.size() + 1);
+		}
+	}
+
+	nodes[node] = children;
+	for (int child = 0; child < count; ++child)
+		if (children.children[child] >= 0)
+			split(primitives, children.children[child], ranges[child], ranges[child + 1]);
+}
+
+int
+ColliderWorld::
+divide(std::vector<Primitive>& primitives, int begin, int end)
+{
+	// median split along the longer side of the box of the primitives'
+	// centers
+	float minX = primitives[begin].left + primitives[begin].right;
+	float maxX = minX;
+	float minY = primitives[begin].top + primitives[begin].bottom;
+	float maxY = minY;
+	for (int i = begin + 1; i < end; ++i)
+	{
+		minX = std::min(minX, primitives[i].left + primitives[i].right);
+		maxX = std::max(maxX, primitives[i].left + primitives[i].right);
+		minY = std::min(minY, primitives[i].top + primitives[i].bottom);
+		maxY = std::max(maxY, primitives[i].top + primitives[i].bottom);
+	}
+
+	int middle = (begin + end) / 2;
+	if (maxX - minX >= maxY - minY)
+		std::nth_element(primitives.begin() + begin, primitives.begin() + middle, primitives.begin() + end,
+			[](const Primitive& a, const Primitive& b) { return a.left + a.right < b.left + b.right; });
+	else
+		std::nth_element(primitives.begin() + begin, primitives.begin() + middle, primitives.begin() + end,
+			[](const Primitive& a, const Primitive& b) { return a.top + a.bottom < b.top + b.bottom; });
+	return middle;
+}
+
+int
+ColliderWorld::
+addLeaf(const std::vector<Primitive>& primitives, int begin, int end)
+{
+	// segments then circles, each padded to a whole group with primitives
+	// that can't be hit
+	Leaf leaf;
+	leaf.firstSegment = (int)segmentX.size() / 4;
+	leaf.firstCircle = (int)circleX.size() / 4;
+	for (int i = begin; i < end; ++i)
+	{
+		const Primitive& p = primitives[i];
+		if (p.circle)
+		{
+			circleX.push_back(circleCenters[p.index].x);
+			circleY.push_back(circleCenters[p.index].y);
+			circleRadius.push_back(circleRadii[p.index]);
+			circleRadius2.push_back(circleRadii[p.index] * circleRadii[p.index]);
+			continue;
+		}
+
+		Vector2 a = segmentStarts[p.index];
+		Vector2 b = segmentEnds[p.index];
+		float dx = b.x - a.x;
+		float dy = b.y - a.y;
+		float length = std::sqrt(dx * dx + dy * dy);
+		segmentX.push_back(a.x);
+		segmentY.push_back(a.y);
+		segmentDX.push_back(dx);
+		segmentDY.push_back(dy);
+		segmentNX.push_back(length > 0 ? -dy / length : 0);
+		segmentNY.push_back(length > 0 ? dx / length : 0);
+	}
+
+	while (segmentX.size() % 4)
+	{
+		segmentX.push_back(0);
+		segmentY.push_back(0);
+		segmentDX.push_back(0);
+		segmentDY.push_back(0);
+		segmentNX.push_back(0);
+		segmentNY.push_back(0);
+	}
+
+	while (circleX.size() % 4)
+	{
+		circleX.push_back(0);
+		circleY.push_back(0);
+		circleRadius.push_back(0);
+		circleRadius2.push_back(-1);
+	}
+
+	leaf.segmentGroups = (int)segmentX.size() / 4 - leaf.firstSegment;
+	leaf.circleGroups = (int)circleX.size() / 4 - leaf.firstCircle;
+	leaves.push_back(leaf);
+	return (int)leaves.size() - 1;
+}
+
+bool
+ColliderWorld::
+cast(float x, float y, float dx, float dy, float& t, float& nx, float& ny) const
+{
+	// Walks the nodes whose box overlaps the box of the path, and tests the
+	// leaves' primitives four at a time for the earliest hit, with t the
+	// fraction of the path it happens at
+	float left = std::min(x, x + dx);
+	float top = std::min(y, y + dy);
+	float right = std::max(x, x + dx);
+	float bottom = std::max(y, y + dy);
+	float a = dx * dx + dy * dy;
+	int hitCircle = -1;
+	int hitSegment = -1;
+	t = 1;
+
+	// every level leaves at most three entries behind, and median splits
+	// keep the tree shallow
+	int stack[64];
+	int size = 0;
+	stack[size++] = 0;
+	while (size > 0)
+	{
+		int item = stack[--size];
+		if (item >= 0)
+		{
+			const Node& node = nodes[item];
+#if defined(COLLIDER_WORLD_SSE2)
+			__m128 overlaps = _mm_and_ps(
+				_mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(node.left), _mm_set1_ps(right)), _mm_cmpge_ps(_mm_loadu_ps(node.right), _mm_set1_ps(left))),
+				_mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(node.top), _mm_set1_ps(bottom)), _mm_cmpge_ps(_mm_loadu_ps(node.bottom), _mm_set1_ps(top))));
+			int mask = _mm_movemask_ps(overlaps);
+#else
+			int mask = 0;
+			for (int child = 0; child < 4; ++child)
+				if (node.left[child] <= right && node.right[child] >= left && node.top[child] <= bottom && node.bottom[child] >= top)
+					mask |= 1 << child;
+#endif
+			for (int child = 0; mask; ++child, mask >>= 1)
+				if (mask & 1)
+					stack[size++] = node.children[child];
+			continue;
+		}
+
+		const Leaf& leaf = leaves[~item];
+		float lanes[4];
+		int mask;
+		for (int group = leaf.firstSegment; group < leaf.firstSegment + leaf.segmentGroups; ++group)
+		{
+			// where x + t dx = segment start + s segment delta, t and s in
+			// [0, 1]; parallel or degenerate segments divide by zero and
+			// fail every comparison
+			int first = group * 4;
+#if defined(COLLIDER_WORLD_SSE2)
+			__m128 wx = _mm_sub_ps(_mm_loadu_ps(segmentX.data() + first), _mm_set1_ps(x));
+			__m128 wy = _mm_sub_ps(_mm_loadu_ps(segmentY.data() + first), _mm_set1_ps(y));
+			__m128 ex = _mm_loadu_ps(segmentDX.data() + first);
+			__m128 ey = _mm_loadu_ps(segmentDY.data() + first);
+			__m128 px = _mm_set1_ps(dx);
+			__m128 py = _mm_set1_ps(dy);
+			__m128 denominator = _mm_sub_ps(_mm_mul_ps(px, ey), _mm_mul_ps(py, ex));
+			__m128 along = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(wx, ey), _mm_mul_ps(wy, ex)), denominator);
+			__m128 across = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(wx, py), _mm_mul_ps(wy, px)), denominator);
+			__m128 hits = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(along, _mm_setzero_ps()), _mm_cmplt_ps(along, _mm_set1_ps(t))),
+				_mm_and_ps(_mm_cmpge_ps(across, _mm_setzero_ps()), _mm_cmple_ps(across, _mm_set1_ps(1.0f))));
+			mask = _mm_movemask_ps(hits);
+			_mm_storeu_ps(lanes, along);
+#else
+			mask = 0;
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				float wx = segmentX[first + lane] - x;
+				float wy = segmentY[first + lane] - y;
+				float ex = segmentDX[first + lane];
+				float ey = segmentDY[first + lane];
+				float denominator = dx * ey - dy * ex;
+				float along = (wx * ey - wy * ex) / denominator;
+				float across = (wx * dy - wy * dx) / denominator;
+				lanes[lane] = along;
+				if (along >= 0 && along < t && across >= 0 && across <= 1)
+					mask |= 1 << lane;
+			}
+#endif
+			for (int lane = 0; mask; ++lane, mask >>= 1)
+			{
+				if ((mask & 1) && lanes[lane] < t)
+				{
+					t = lanes[lane];
+					hitSegment = first + lane;
+					hitCircle = -1;
+				}
+			}
+		}
+
+		for (int group = leaf.firstCircle; group < leaf.firstCircle + leaf.circleGroups; ++group)
+		{
+			// entering hits only, where |x + t dx - center| = radius; the
+			// padding has a negative squared radius and never gets there
+			int first = group * 4;
+#if defined(COLLIDER_WORLD_SSE2)
+			__m128 fx = _mm_sub_ps(_mm_set1_ps(x), _mm_loadu_ps(circleX.data() + first));
+			__m128 fy = _mm_sub_ps(_mm_set1_ps(y), _mm_loadu_ps(circleY.data() + first));
+			__m128 b = _mm_add_ps(_mm_mul_ps(fx, _mm_set1_ps(dx)), _mm_mul_ps(fy, _mm_set1_ps(dy)));
+			__m128 c = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(fx, fx), _mm_mul_ps(fy, fy)), _mm_loadu_ps(circleRadius2.data() + first));
+			__m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(_mm_set1_ps(a), c));
+			__m128 along = _mm_div_ps(_mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(), b), _mm_sqrt_ps(_mm_max_ps(discriminant, _mm_setzero_ps()))), _mm_set1_ps(a));
+			__m128 hits = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(c, _mm_setzero_ps()), _mm_cmplt_ps(b, _mm_setzero_ps())),
+				_mm_and_ps(_mm_cmpge_ps(discriminant, _mm_setzero_ps()), _mm_cmplt_ps(along, _mm_set1_ps(t))));
+			mask = _mm_movemask_ps(hits);
+			_mm_storeu_ps(lanes, along);
+#else
+			mask = 0;
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				float fx = x - circleX[first + lane];
+				float fy = y - circleY[first + lane];
+				float b = fx * dx + fy * dy;
+				float c = fx * fx + fy * fy - circleRadius2[first + lane];
+				float discriminant = b * b - a * c;
+				float along = (-b - std::sqrt(std::max(discriminant, 0.0f))) / a;
+				lanes[lane] = along;
+				if (c > 0 && b < 0 && discriminant >= 0 && along < t)
+					mask |= 1 << lane;
+			}
+#endif
+			for (int lane = 0; mask; ++lane, mask >>= 1)
+			{
+				if ((mask & 1) && lanes[lane] < t)
+				{
+					t = lanes[lane];
+					hitCircle = first + lane;
+					hitSegment = -1;
+				}
+			}
+		}
+	}
+
+	if (hitSegment >= 0)
+	{
+		// the side the path came from
+		nx = segmentNX[hitSegment];
+		ny = segmentNY[hitSegment];
+		if (nx * dx + ny * dy > 0)
+		{
+			nx = -nx;
+			ny = -ny;
+		}
+		return true;
+	}
+
+	if (hitCircle >= 0)
+	{
+		nx = (x + dx * t - circleX[hitCircle]) / circleRadius[hitCircle];
+		ny = (y + dy * t - circleY[hitCircle]) / circleRadius[hitCircle];
+		return true;
+	}
+
+	return false;
+}
+
+void
+ColliderWorld::
+collide(ParticleChunk& chunk, int begin, int end, const float* fromX, const float* fromY, const unsigned char* responses, const float* restitutions) const
+{
+	if (nodes.empty())
+		return;
+
+	for (int i = begin; i < end; ++i)
+	{
+		Response response = (Response)responses[chunk.emitter[i]];
+		if (response == Pass)
+			continue;
+
+		float x = fromX[i - begin];
+		float y = fromY[i - begin];
+		float dx = chunk.x[i] - x;
+		float dy = chunk.y[i] - y;
+		if (dx == 0 && dy == 0)
+			continue;
+
+		// most particles are nowhere near an obstacle
+		if (std::max(x, chunk.x[i]) < worldLeft || std::min(x, chunk.x[i]) > worldRight || std::max(y, chunk.y[i]) < worldTop || std::min(y, chunk.y[i]) > worldBottom)
+			continue;
+
+		// A bouncing particle carries on with what is left of its path,
+		// reflected, until it has used up its casts
+		float restitution = restitutions[chunk.emitter[i]];
+		float t;
+		float nx;
+		float ny;
+		int hits = 0;
+		while (cast(x, y, dx, dy, t, nx, ny))
+		{
+			x += dx * t + nx * SKIN;
+			y += dy * t + ny * SKIN;
+			++hits;
+			if (response != Bounce)
+				break;
+
+			float normal = chunk.vx[i] * nx + chunk.vy[i] * ny;
+			if (normal < 0)
+			{
+				chunk.vx[i] -= (1 + restitution) * normal * nx;
+				chunk.vy[i] -= (1 + restitution) * normal * ny;
+			}
+
+			dx *= 1 - t;
+			dy *= 1 - t;
+			normal = dx * nx + dy * ny;
+			dx -= (1 + restitution) * normal * nx;
+			dy -= (1 + restitution) * normal * ny;
+			if (hits == MAX_BOUNCES || (dx == 0 && dy == 0))
+				break;
+		}
+
+		if (hits == 0)
+			continue;
+
+		if (response == Bounce && hits < MAX_BOUNCES)
+		{
+			x += dx;
+			y += dy;
+		}
+		else if (response == Stick)
+		{
+			chunk.vx[i] = 0;
+			chunk.vy[i] = 0;
+			chunk.gravity[i] = 0;
+		}
+		else if (response == Kill)
+		{
+			chunk.age[i] = chunk.lifetime[i];
+		}
+
+		chunk.x[i] = x;
+		chunk.y[i] = y;
+	}
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <vector>
+
+#include "ParticleBuffer.h"
+#include "Vector2.h"
+
+// Static obstacles particles run into: segments, circles, boxes and
+// polylines, all made of segments and circles. They are kept in a bounding
+// volume hierarchy, so a particle only tests the few primitives near its
+// path however many there are. Every node has four children whose boxes a
+// particle tests at once with SSE2, and a leaf stores its segments and its
+// circles in groups of four, each array separate, tested at once as well.
+// Every particle casts the segment it moved along during the step, so fast
+// ones can't tunnel through thin obstacles, and what happens when it hits
+// depends on its emitter's response.
+class ColliderWorld
+{
+public:
+	enum Response
+	{
+		// goes through
+		Pass,
+		// reflects off with the emitter's restitution, frictionless
+		Bounce,
+		// stops where it hit and no longer falls
+		Stick,
+		// dies where it hit
+		Kill
+	};
+
+	// Primitives a leaf holds at most
+	static const int LEAF_SIZE = 4;
+
+	// Casts a bouncing particle gets per step
+	static const int MAX_BOUNCES = 3;
+
+	// Distance particles are kept off the surfaces they hit, in pixels
+	static const float SKIN;
+
+private:
+	struct Primitive
+	{
+		float left;
+		float top;
+		float right;
+		float bottom;
+		// index of the segment, or of the circle with circle set
+		int index;
+		bool circle;
+	};
+
+	// primitives as added
+	std::vector<Vector2> segmentStarts;
+	std::vector<Vector2> segmentEnds;
+	std::vector<Vector2> circleCenters;
+	std::vector<float> circleRadii;
+	bool dirty;
+
+	// Four children per node, tested at once: their boxes, and for each
+	// the index of its node, or the complement of the index of its leaf.
+	// Unused slots have an inverted box that overlaps nothing.
+	struct Node
+	{
+		float left[4];
+		float top[4];
+		float right[4];
+		float bottom[4];
+		int children[4];
+	};
+
+	// groups of four primitives of a leaf
+	struct Leaf
+	{
+		int firstSegment;
+		int segmentGroups;
+		int firstCircle;
+		int circleGroups;
+	};
+
+	// the hierarchy, the root first, its leaves and their primitives;
+	// unused slots of a group are degenerate and never hit
+	std::vector<Node> nodes;
+	std::vector<Leaf> leaves;
+	// box around everything
+	float worldLeft;
+	float worldTop;
+	float worldRight;
+	float worldBottom;
+	std::vector<float> segmentX;
+	std::vector<float> segmentY;
+	std::vector<float> segmentDX;
+	std::vector<float> segmentDY;
+	std::vector<float> segmentNX;
+	std::vector<float> segmentNY;
+	std::vector<float> circleX;
+	std::vector<float> circleY;
+	std::vector<float> circleRadius;
+	std::vector<float> circleRadius2;
+
+	void build();
+	void split(std::vector<Primitive>& primitives, int node, int begin, int end);
+	int divide(std::vector<Primitive>& primitives, int begin, int end);
+	int addLeaf(const std::vector<Primitive>& primitives, int begin, int end);
+	bool cast(float x, float y, float dx, float dy, float& t, float& nx, float& ny) const;
+
+public:
+	ColliderWorld();
+
+	void addSegment(const Vector2& from, const Vector2& to);
+	void addCircle(const Vector2& center, float radius);
+	void addBox(const Vector2& topLeft, const Vector2& bottomRight);
+	void addPolyline(const std::vector<Vector2>& points, bool closed = false);
+
+	void clear();
+	int getPrimitiveCount() const;
+	bool isEmpty() const { return getPrimitiveCount() == 0; }
+
+	// Rebuilds the hierarchy if anything was added or cleared since the last
+	// call; call once per update, before collide()
+	void prepare();
+
+	// Moves the particles [begin, end) of the chunk that hit anything on
+	// their way from fromX, fromY, indexed from begin, to where they are
+	// now, given the response and restitution of every emitter. Safe to
+	// call on separate ranges from several threads.
+	void collide(ParticleChunk& chunk, int begin, int end, const float* fromX, const float* fromY, const unsigned char* responses, const float* restitutions) const;
+};
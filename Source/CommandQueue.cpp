@@ -0,0 +1,27 @@
+#include "CommandQueue.h"
+
+void
+CommandQueue::
+post(const std::function<void()>& command)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	pending.push_back(command);
+}
+
+int
+CommandQueue::
+execute()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		running.swap(pending);
+	}
+
+	// commands may post more commands, they run next time
+	for (std::vector<std::function<void()> >::iterator it = running.begin(); it != running.end(); ++it)
+		(*it)();
+
+	int count = running.size();
+	running.clear();
+	return count;
+}
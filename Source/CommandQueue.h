@@ -0,0 +1,20 @@
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Functions posted from any thread and run later, in order, by the thread
+// that owns the state they change.
+class CommandQueue
+{
+	std::mutex mutex;
+	std::vector<std::function<void()> > pending;
+	std::vector<std::function<void()> > running;
+
+public:
+	void post(const std::function<void()>& command);
+
+	// Runs the commands posted so far; returns how many ran
+	int execute();
+};
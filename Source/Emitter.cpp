@@ -1,21 +1,16 @@
 #include "Emitter.h"
 
 #include <algorithm>
-#include <cmath>
-
-#include <SDL/SDL_opengl.h>
-#include <gl/GLU.h>
 
 #define PI 3.14159265
 
-#include "Extensions.h"
+#include "Integrator.h"
 
 Emitter::
-Emitter(const Vector2& position, int width, int height, int rate, float particleSize, float lifetime, bool fade, float radius, float angle, float spread, float minSpeed, float maxSpeed, float gravity, int maxParticles, const SDL_Color& color)
-: maxParticles(maxParticles < 1 ? 1 : maxParticles > MAX_PARTICLES ? MAX_PARTICLES : maxParticles),
-  position(position),
-  width(width),
-  height(height),
+Emitter(const Vector2& position, float rate, float particleSize, float lifetime, bool fade, float radius, float angle, float spread, float minSpeed, float maxSpeed, float gravity, int maxParticles, const SDL_Color& color)
+: position(position),
+  random(0),
+  maxParticles(maxParticles < 1 ? 1 : maxParticles > MAX_PARTICLES ? MAX_PARTICLES : maxParticles),
   rate(rate),
   particleSize(particleSize),
   lifetime(lifetime),
@@ -27,79 +22,67 @@ Emitter(const Vector2& position, int width, int height, int rate, float particle
   gravity(gravity),
   fade(fade),
   enabled(false),
-  color(color)
+  color(color),
+  collisionResponse(ColliderWorld::Bounce),
+  restitution(0.5f)
 {
 }
 
 Emitter::
 ~Emitter()
 {
-	for (std::deque<Particle*>::iterator it = particles.begin(); it != particles.end(); ++it)
-	{
-		delete *it;
-	}
-
-	particles.clear();
 }
 
-void 
+void
 Emitter::
-update(float deltaTime)
+spawn(ParticleBuffer& particles, int count, unsigned short id, unsigned char colorIndex)
 {
-	// remove dead particles
-	for (std::deque<Particle*>::iterator it = particles.begin(); it != particles.end();)
-	{
-		Particle* p = *it;
-		if (p->isDead())
-		{
-			it = particles.erase(it);
-			delete p;
-		}
-		else
-		{
-			p->update(deltaTime);
-			++it;
-		}
-	}
-
-	// create new ones
-	if (enabled)
+	// Spawns in batches: draw all the random numbers of a batch at once,
+	// evaluate the directions with the vectorized sincos, then write the
+	// particles straight into the buffer
+	float angles[BLOCK_SIZE];
+	float sines[BLOCK_SIZE];
+	float cosines[BLOCK_SIZE];
+	float speeds[BLOCK_SIZE];
+	float radii[BLOCK_SIZE];
+
+	float halfspread = spread / 2;
+	while (count > 0)
 	{
-		int spawns = std::min((int)std::ceil(rate * deltaTime), maxParticles - (int)particles.size());
-		while (spawns > 0)
+		// a batch never straddles two chunks
+		int offset = particles.size() % ParticleBuffer::CHUNK_SIZE;
+		int n = std::min(std::min(count, (int)BLOCK_SIZE), ParticleBuffer::CHUNK_SIZE - offset);
+		count -= n;
+
+		random.fill(angles, n, (angle - halfspread) * float(PI / 180.0), (angle + halfspread) * float(PI / 180.0));
+		random.fill(speeds, n, minSpeed, maxSpeed);
+		random.fill(radii, n, radius / 2, radius);
+		Integrator::sincos(angles, sines, cosines, n);
+
+		ParticleChunk& chunk = particles.getChunk(particles.append(n) / ParticleBuffer::CHUNK_SIZE);
+		float* x = chunk.x + offset;
+		float* y = chunk.y + offset;
+		float* vx = chunk.vx + offset;
+		float* vy = chunk.vy + offset;
+		for (int i = 0; i < n; ++i)
 		{
-			float halfspread = spread / 2;
-			float radians = (angle + std::random(-halfspread, +halfspread)) * PI / 180.0;
-			float speed = std::random(minSpeed, maxSpeed);
-
-			Vector2 point(cos(radians), -sin(radians));
-			float r = std::random(radius/2, radius);
-			Particle* p = new Particle(position + (point * r), point * speed, lifetime, gravity, fade, color);
-			particles.push_back(p);
-
-			spawns--;
+			// screen y points down
+			x[i] = position.x + cosines[i] * radii[i];
+			y[i] = position.y - sines[i] * radii[i];
+			vx[i] = cosines[i] * speeds[i];
+			vy[i] = -sines[i] * speeds[i];
 		}
-	}
-}
 
-void
-Emitter::
-render()
-{
-	glPointSize(particleSize);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glBegin(GL_POINTS);
-
-	for (std::deque<Particle*>::iterator it = particles.begin(); it != particles.end(); ++it)
-	{
-		if (!(*it)->isDead() && (*it)->isInside(0, 0, width, height))
-			(*it)->render();
+		std::fill(chunk.age + offset, chunk.age + offset + n, 0.0f);
+		std::fill(chunk.lifetime + offset, chunk.lifetime + offset + n, lifetime);
+		std::fill(chunk.gravity + offset, chunk.gravity + offset + n, gravity);
+		std::fill(chunk.fade + offset, chunk.fade + offset + n, (unsigned char)fade);
+		std::fill(chunk.color + offset, chunk.color + offset + n, color);
+		std::fill(chunk.colorIndex + offset, chunk.colorIndex + offset + n, colorIndex);
+		std::fill(chunk.emitter + offset, chunk.emitter + offset + n, id);
 	}
-
-	glEnd();
 }
 
-
 void 
 Emitter::
 setEnabled(bool value)
@@ -114,18 +97,11 @@ getEnabled()
     return enabled;
 }
 
-int
-Emitter::
-getParticleCount()
-{
-	return particles.size();
-}
-
 void 
 Emitter::
 setMaxParticles(int value)
 {
-	maxParticles = value;
+	maxParticles = value < 1 ? 1 : value > MAX_PARTICLES ? MAX_PARTICLES : value;
 }
 
 void 
@@ -205,6 +181,27 @@ setColor(const SDL_Color& value)
 	color = value;
 }
 
+void
+Emitter::
+setRandomStream(uint64_t stream)
+{
+	random.seed(Random::getMasterSeed(), stream);
+}
+
+void
+Emitter::
+setCollisionResponse(ColliderWorld::Response value)
+{
+	collisionResponse = value;
+}
+
+void
+Emitter::
+setRestitution(float value)
+{
+	restitution = std::max(value, 0.0f);
+}
+
 int 
 Emitter::
 getMaxParticles()
@@ -289,3 +286,17 @@ getColor()
 {
 	return color;
 }
+
+ColliderWorld::Response
+Emitter::
+getCollisionResponse()
+{
+	return collisionResponse;
+}
+
+float
+Emitter::
+getRestitution()
+{
+	return restitution;
+}
@@ -1,26 +1,28 @@
 #pragma once
 
-#include <random>
-#include <deque>
-
 #include "SDL/SDL.h"
 
-#include "Particle.h"
+#include "ColliderWorld.h"
+#include "ParticleBuffer.h"
+#include "Random.h"
 #include "Vector2.h"
 
+// Spawns particles with its settings into the store of the ParticleSystem
+// it belongs to, which updates and draws them along with everyone else's.
 class Emitter
 {
 public:
-    static const int MAX_PARTICLES = 65535;
+    static const int MAX_PARTICLES = 16777216;
+
+	// Number of particles spawned at a time
+	static const int BLOCK_SIZE = 256;
 
     Vector2 position;
 
 private:
-	int width;
-	int height;
-	std::deque<Particle*> particles;
+	Random random;
 	int maxParticles;
-    int rate;
+    float rate;
 	float particleSize;
     float lifetime;
     float radius;
@@ -32,20 +34,21 @@ private:
 	bool fade;
     bool enabled;
 	SDL_Color color;
+	ColliderWorld::Response collisionResponse;
+	float restitution;
 
 public:
-    Emitter(const Vector2& position = Vector2::Zero, int width = 200, int height = 200, int rate = 1, float particleSize = 2, float lifetime = 10, bool fade = false, float radius = 10, float angle = 90, float spread = 30, float minSpeed = 0, float maxSpeed = 0, float gravity = 9.8, int maxParticles = 2048, const SDL_Color& color = { 255, 255, 255, 255 });
+    Emitter(const Vector2& position = Vector2::Zero, float rate = 1, float particleSize = 2, float lifetime = 10, bool fade = false, float radius = 10, float angle = 90, float spread = 30, float minSpeed = 0, float maxSpeed = 0, float gravity = 9.8, int maxParticles = 2048, const SDL_Color& color = { 255, 255, 255, 255 });
 
     ~Emitter();
 
-    void update(float deltaTime);
-	void render();
+	// Appends count particles to the buffer, tagged with the emitter's id
+	// and colored with the given palette slot
+	void spawn(ParticleBuffer& particles, int count, unsigned short id, unsigned char colorIndex);
 
     void setEnabled(bool value);
     bool getEnabled(); 
 
-    int getParticleCount();
-
 	void setMaxParticles(int value);
 	void setRate(float value);
 	void setParticleSize(float value);
@@ -59,6 +62,18 @@ public:
 	void setFade(bool value);
 	void setColor(const SDL_Color& value);
 
+	// Restarts the emitter's random numbers on the given stream of the
+	// master seed; ParticleSystem::add uses the emitter's id, so a run
+	// replays from its seed as long as the emitters are added in the same
+	// order, whatever order they were created in
+	void setRandomStream(uint64_t stream);
+
+	// What the particles do when they hit an obstacle of the ParticleSystem's
+	// ColliderWorld, and the fraction of their speed into it they bounce
+	// back with
+	void setCollisionResponse(ColliderWorld::Response value);
+	void setRestitution(float value);
+
 	int getMaxParticles();
 	float getRate();
 	float getParticleSize();
@@ -71,4 +86,6 @@ public:
 	float getGravity();
 	bool getFade();
 	SDL_Color getColor();
-};
\ No newline at end of file
+	ColliderWorld::Response getCollisionResponse();
+	float getRestitution();
+};
@@ -1,20 +1,25 @@
 #include "Extensions.h"
 #include "StringUtil.h"
 
+#include "Random.h"
+
 #include <cstdlib>
-#include <cfloat>   // DBL_MAX
-#include <cmath>    // std::nextafter
 #include <algorithm>
+#include <random>
 
 FILE _iob[] = { *stdin, *stdout, *stderr };
 extern "C" FILE * __cdecl __iob_func(void) { return _iob; }
 
-std::default_random_engine&
-std::
-global_urng()
+namespace
 {
-	static std::default_random_engine u{};
-	return u;
+	// Stream for the std::random helpers; emitters and workers draw from their
+	// own streams of the same master seed
+	Random&
+	global_random()
+	{
+		static Random generator(~0ull);
+		return generator;
+	}
 }
 
 void
@@ -22,7 +27,15 @@ std::
 randomize()
 {
 	static std::random_device rd{};
-	global_urng().seed(rd());
+	randomize((uint64_t(rd()) << 32) | rd());
+}
+
+void
+std::
+randomize(unsigned long long seed)
+{
+	Random::setMasterSeed(seed);
+	global_random().seed(Random::getMasterSeed(), ~0ull);
 }
 
 
@@ -30,10 +43,7 @@ double
 std::
 random()
 {
-    // Note: uniform_real_distribution does [start, stop), but we want to do [start, stop].
-    // Pass the next largest value instead.
-    static std::uniform_real_distribution<double> next(0, std::nextafter(1, DBL_MAX));
-    return next(std::global_urng());
+    return global_random().nextFloat();
 }
 
 double
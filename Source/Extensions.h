@@ -1,15 +1,14 @@
 #pragma once
 
-#include <random>
-
 namespace std
 {
-	std::default_random_engine&
-	global_urng();
-	
 	void
 	randomize();
 
+	// Seeds with the given value rather than a random one
+	void
+	randomize(unsigned long long seed);
+
     double
     random();
 
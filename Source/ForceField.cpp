@@ -0,0 +1,295 @@
+#include "ForceField.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Integrator.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define FORCE_FIELD_SSE2
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+// MSVC lets any function use AVX intrinsics, GCC and Clang need to be told
+#if defined(__GNUC__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+ForceField::
+ForceField()
+: drag(0),
+  windX(0),
+  windY(0),
+  damping(1),
+  response(0),
+  windCount(0),
+  dragCount(0)
+{
+}
+
+void
+ForceField::
+addAttractor(const Vector2& position, float strength, float radius, Body* body)
+{
+	attractorX.push_back(position.x);
+	attractorY.push_back(position.y);
+	attractorStrength.push_back(strength);
+	attractorRadius2.push_back(std::max(radius * radius, 1.0f));
+	attractorBodies.push_back(body);
+}
+
+void
+ForceField::
+addVortex(const Vector2& position, float strength, float radius, Body* body)
+{
+	vortexX.push_back(position.x);
+	vortexY.push_back(position.y);
+	vortexStrength.push_back(strength);
+	vortexRadius2.push_back(std::max(radius * radius, 1.0f));
+	vortexBodies.push_back(body);
+}
+
+void
+ForceField::
+addWind(const Vector2& velocity, float coefficient)
+{
+	coefficient = std::max(coefficient, 0.0f);
+	drag += coefficient;
+	windX += velocity.x * coefficient;
+	windY += velocity.y * coefficient;
+	++windCount;
+}
+
+void
+ForceField::
+addDrag(float coefficient)
+{
+	drag += std::max(coefficient, 0.0f);
+	++dragCount;
+}
+
+void
+ForceField::
+addFlow(const VectorField* field, float coefficient)
+{
+	coefficient = std::max(coefficient, 0.0f);
+	maps.push_back(field);
+	mapScales.push_back(coefficient);
+	drag += coefficient;
+}
+
+void
+ForceField::
+addForceMap(const VectorField* field, float scale)
+{
+	maps.push_back(field);
+	mapScales.push_back(scale);
+}
+
+void
+ForceField::
+clear()
+{
+	attractorX.clear();
+	attractorY.clear();
+	attractorStrength.clear();
+	attractorRadius2.clear();
+	attractorBodies.clear();
+	vortexX.clear();
+	vortexY.clear();
+	vortexStrength.clear();
+	vortexRadius2.clear();
+	vortexBodies.clear();
+	maps.clear();
+	mapScales.clear();
+	drag = 0;
+	windX = 0;
+	windY = 0;
+	windCount = 0;
+	dragCount = 0;
+}
+
+int
+ForceField::
+getFieldCount() const
+{
+	return (int)attractorX.size() + (int)vortexX.size() + (int)maps.size() + windCount + dragCount;
+}
+
+void
+ForceField::
+prepare(float deltaTime)
+{
+	for (int i = 0; i < (int)attractorBodies.size(); ++i)
+	{
+		if (attractorBodies[i])
+		{
+			attractorX[i] = attractorBodies[i]->position.x;
+			attractorY[i] = attractorBodies[i]->position.y;
+		}
+	}
+
+	for (int i = 0; i < (int)vortexBodies.size(); ++i)
+	{
+		if (vortexBodies[i])
+		{
+			vortexX[i] = vortexBodies[i]->position.x;
+			vortexY[i] = vortexBodies[i]->position.y;
+		}
+	}
+
+	// dv/dt = wind - drag * v + a, solved exactly over the step for a
+	// constant a, so strong drag can't overshoot and reverse the velocity
+	damping = std::exp(-drag * deltaTime);
+	response = drag > 0 ? (1 - damping) / drag : deltaTime;
+}
+
+void
+ForceField::
+apply(ParticleChunk& chunk, int begin, int end) const
+{
+	// the winds and the sampled grids give every particle of a block the
+	// acceleration the analytic fields add to
+	float baseX[BLOCK_SIZE];
+	float baseY[BLOCK_SIZE];
+	for (int block = begin; block < end; block += BLOCK_SIZE)
+	{
+		int count = std::min(BLOCK_SIZE, end - block);
+		std::fill(baseX, baseX + count, windX);
+		std::fill(baseY, baseY + count, windY);
+		for (int m = 0; m < (int)maps.size(); ++m)
+			maps[m]->accumulate(chunk.x + block, chunk.y + block, count, mapScales[m], baseX, baseY);
+		applyBlock(chunk, block, block + count, baseX, baseY);
+	}
+}
+
+void
+ForceField::
+applyBlock(ParticleChunk& chunk, int begin, int end, const float* baseX, const float* baseY) const
+{
+	// Four particles at a time go through every attractor then every
+	// vortex, their accelerations staying in registers
+	int attractors = (int)attractorX.size();
+	int vortices = (int)vortexX.size();
+	const float* x = chunk.x;
+	const float* y = chunk.y;
+	float* vx = chunk.vx;
+	float* vy = chunk.vy;
+	int i = begin;
+#if defined(FORCE_FIELD_SSE2)
+	if (Integrator::getSupportedISA() == Integrator::AVX2)
+		i = applyBlockAVX2(chunk, begin, end, baseX, baseY);
+
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 damping4 = _mm_set1_ps(damping);
+	const __m128 response4 = _mm_set1_ps(response);
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 px = _mm_loadu_ps(x + i);
+		__m128 py = _mm_loadu_ps(y + i);
+		__m128 ax = _mm_loadu_ps(baseX + i - begin);
+		__m128 ay = _mm_loadu_ps(baseY + i - begin);
+		for (int f = 0; f < attractors; ++f)
+		{
+			__m128 dx = _mm_sub_ps(_mm_set1_ps(attractorX[f]), px);
+			__m128 dy = _mm_sub_ps(_mm_set1_ps(attractorY[f]), py);
+			__m128 inverse = _mm_div_ps(one, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_set1_ps(attractorRadius2[f])));
+			__m128 pull = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(attractorStrength[f]), inverse), _mm_sqrt_ps(inverse));
+			ax = _mm_add_ps(ax, _mm_mul_ps(dx, pull));
+			ay = _mm_add_ps(ay, _mm_mul_ps(dy, pull));
+		}
+
+		for (int f = 0; f < vortices; ++f)
+		{
+			__m128 dx = _mm_sub_ps(px, _mm_set1_ps(vortexX[f]));
+			__m128 dy = _mm_sub_ps(py, _mm_set1_ps(vortexY[f]));
+			__m128 spin = _mm_div_ps(_mm_set1_ps(vortexStrength[f]), _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_set1_ps(vortexRadius2[f])));
+			ax = _mm_sub_ps(ax, _mm_mul_ps(dy, spin));
+			ay = _mm_add_ps(ay, _mm_mul_ps(dx, spin));
+		}
+
+		_mm_storeu_ps(vx + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(vx + i), damping4), _mm_mul_ps(ax, response4)));
+		_mm_storeu_ps(vy + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(vy + i), damping4), _mm_mul_ps(ay, response4)));
+	}
+#endif
+	for (; i < end; ++i)
+	{
+		float ax = baseX[i - begin];
+		float ay = baseY[i - begin];
+		for (int f = 0; f < attractors; ++f)
+		{
+			float dx = attractorX[f] - x[i];
+			float dy = attractorY[f] - y[i];
+			float inverse = 1.0f / (dx * dx + dy * dy + attractorRadius2[f]);
+			float pull = attractorStrength[f] * inverse * std::sqrt(inverse);
+			ax += dx * pull;
+			ay += dy * pull;
+		}
+
+		for (int f = 0; f < vortices; ++f)
+		{
+			float dx = x[i] - vortexX[f];
+			float dy = y[i] - vortexY[f];
+			float spin = vortexStrength[f] / (dx * dx + dy * dy + vortexRadius2[f]);
+			ax -= dy * spin;
+			ay += dx * spin;
+		}
+
+		vx[i] = vx[i] * damping + ax * response;
+		vy[i] = vy[i] * damping + ay * response;
+	}
+}
+
+#if defined(FORCE_FIELD_SSE2)
+TARGET_AVX2
+int
+ForceField::
+applyBlockAVX2(ParticleChunk& chunk, int begin, int end, const float* baseX, const float* baseY) const
+{
+	// the SSE2 loop of applyBlock() eight particles wide, with the same
+	// results
+	int attractors = (int)attractorX.size();
+	int vortices = (int)vortexX.size();
+	const float* x = chunk.x;
+	const float* y = chunk.y;
+	float* vx = chunk.vx;
+	float* vy = chunk.vy;
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 damping8 = _mm256_set1_ps(damping);
+	const __m256 response8 = _mm256_set1_ps(response);
+	int i = begin;
+	for (; i + 8 <= end; i += 8)
+	{
+		__m256 px = _mm256_loadu_ps(x + i);
+		__m256 py = _mm256_loadu_ps(y + i);
+		__m256 ax = _mm256_loadu_ps(baseX + i - begin);
+		__m256 ay = _mm256_loadu_ps(baseY + i - begin);
+		for (int f = 0; f < attractors; ++f)
+		{
+			__m256 dx = _mm256_sub_ps(_mm256_set1_ps(attractorX[f]), px);
+			__m256 dy = _mm256_sub_ps(_mm256_set1_ps(attractorY[f]), py);
+			__m256 inverse = _mm256_div_ps(one, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_set1_ps(attractorRadius2[f])));
+			__m256 pull = _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(attractorStrength[f]), inverse), _mm256_sqrt_ps(inverse));
+			ax = _mm256_add_ps(ax, _mm256_mul_ps(dx, pull));
+			ay = _mm256_add_ps(ay, _mm256_mul_ps(dy, pull));
+		}
+
+		for (int f = 0; f < vortices; ++f)
+		{
+			__m256 dx = _mm256_sub_ps(px, _mm256_set1_ps(vortexX[f]));
+			__m256 dy = _mm256_sub_ps(py, _mm256_set1_ps(vortexY[f]));
+			__m256 spin = _mm256_div_ps(_mm256_set1_ps(vortexStrength[f]), _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_set1_ps(vortexRadius2[f])));
+			ax = _mm256_sub_ps(ax, _mm256_mul_ps(dy, spin));
+			ay = _mm256_add_ps(ay, _mm256_mul_ps(dx, spin));
+		}
+
+		_mm256_storeu_ps(vx + i, _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(vx + i), damping8), _mm256_mul_ps(ax, response8)));
+		_mm256_storeu_ps(vy + i, _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(vy + i), damping8), _mm256_mul_ps(ay, response8)));
+	}
+	_mm256_zeroupper();
+	return i;
+}
+#endif
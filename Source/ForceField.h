@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vector>
+
+#include "Body.h"
+#include "ParticleBuffer.h"
+#include "Vector2.h"
+#include "VectorField.h"
+
+// Analytic forces applied to every particle on top of its emitter's
+// gravity. Fields are kept in one set of arrays per type rather than as
+// objects, and four particles at a time, eight where the CPU has AVX2, go
+// through every field of every type in one vectorized loop, so dozens of
+// fields cost a few multiplies per particle each and no calls. Winds and
+// drags are all linear in the velocity, so they are summed into a single
+// exact damping step however many there are. Attractors and vortices can
+// follow a body, which moves them to the body's position at every update.
+// Grids of vectors, such as wind maps, are sampled a block of particles at
+// a time before the analytic fields.
+class ForceField
+{
+public:
+	// Particles the grids are sampled for at a time, small enough for their
+	// accelerations to stay in L1
+	static const int BLOCK_SIZE = 256;
+
+private:
+	// per attractor and per vortex: center, strength, squared core radius
+	// and the body it follows, if any
+	std::vector<float> attractorX;
+	std::vector<float> attractorY;
+	std::vector<float> attractorStrength;
+	std::vector<float> attractorRadius2;
+	std::vector<Body*> attractorBodies;
+	std::vector<float> vortexX;
+	std::vector<float> vortexY;
+	std::vector<float> vortexStrength;
+	std::vector<float> vortexRadius2;
+	std::vector<Body*> vortexBodies;
+	// sampled grids and what their vectors are multiplied with
+	std::vector<const VectorField*> maps;
+	std::vector<float> mapScales;
+	// sum of the drag coefficients, of the wind velocities weighted by their
+	// coefficient, and what they make of one step
+	float drag;
+	float windX;
+	float windY;
+	float damping;
+	float response;
+	int windCount;
+	int dragCount;
+
+	void applyBlock(ParticleChunk& chunk, int begin, int end, const float* baseX, const float* baseY) const;
+	// applyBlock() eight particles at a time where the CPU has AVX2,
+	// returning the first particle it left for the narrower loops
+	int applyBlockAVX2(ParticleChunk& chunk, int begin, int end, const float* baseX, const float* baseY) const;
+
+public:
+	ForceField();
+
+	// Pulls particles towards position with an acceleration of strength / d^2
+	// at a distance d, in px^3/s^2 like a body's mass, softened within radius
+	// of the center; a negative strength pushes them away. Follows body
+	// instead when given one.
+	void addAttractor(const Vector2& position, float strength, float radius, Body* body = nullptr);
+
+	// Spins particles around position with an acceleration of strength / d
+	// at a distance d, in px^2/s^2, clockwise on screen when positive and
+	// softened within radius of the center. Follows body instead when given
+	// one.
+	void addVortex(const Vector2& position, float strength, float radius, Body* body = nullptr);
+
+	// Drags particles towards the given velocity, in px/s, coefficient
+	// being the fraction of the difference made up per second at first
+	void addWind(const Vector2& velocity, float coefficient);
+
+	// Slows particles down, by coefficient times their velocity per second
+	void addDrag(float coefficient);
+
+	// Drags particles towards the velocity the grid gives at their position,
+	// like a wind that changes from place to place. The grid isn't copied
+	// and must outlive the force field, or be removed with clear(); see
+	// VectorField for when it may change.
+	void addFlow(const VectorField* field, float coefficient);
+
+	// Accelerates particles by scale times the vector the grid gives at their
+	// position, in px/s^2. The grid isn't copied either.
+	void addForceMap(const VectorField* field, float scale = 1);
+
+	void clear();
+	int getFieldCount() const;
+	bool isEmpty() const { return getFieldCount() == 0; }
+
+	// Moves the fields that follow bodies and works out the damping of one
+	// step; call once per update, before apply()
+	void prepare(float deltaTime);
+
+	// Accelerates the particles [begin, end) of the chunk. Safe to call on
+	// separate ranges from several threads.
+	void apply(ParticleChunk& chunk, int begin, int end) const;
+};
@@ -0,0 +1,234 @@
+#include "FrameCapture.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "SDL/SDL_image.h"
+
+#include "GLFunctions.h"
+
+FrameCapture::
+FrameCapture(const std::string& prefix, int width, int height, Format format, Policy policy, int queueSize)
+: prefix(prefix),
+  width(width),
+  height(height),
+  format(format),
+  policy(policy),
+  readbacks(0),
+  mapped(0),
+  frames(std::max(queueSize, 1)),
+  stopping(false),
+  captured(0),
+  written(0),
+  dropped(0),
+  totalLatency(0),
+  maxLatency(0)
+{
+	// every buffer is allocated up front, capturing never touches the heap
+	for (std::vector<Frame>::iterator it = frames.begin(); it != frames.end(); ++it)
+	{
+		it->pixels.resize((size_t)width * height * 4);
+		freeFrames.push_back(&*it);
+	}
+
+	std::fill(pixelBuffers, pixelBuffers + READBACK_BUFFERS, 0);
+	encoder = std::thread(&FrameCapture::encode, this);
+}
+
+FrameCapture::
+~FrameCapture()
+{
+	flush();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	queued.notify_all();
+	encoder.join();
+
+	if (pixelBuffers[0])
+		GLFunctions::glDeleteBuffers(READBACK_BUFFERS, pixelBuffers);
+}
+
+void
+FrameCapture::
+capture()
+{
+	if (!pixelBuffers[0] && GLFunctions::hasPixelBuffers())
+	{
+		GLFunctions::glGenBuffers(READBACK_BUFFERS, pixelBuffers);
+		for (int i = 0; i < READBACK_BUFFERS; ++i)
+		{
+			GLFunctions::glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[i]);
+			GLFunctions::glBufferData(GL_PIXEL_PACK_BUFFER, (size_t)width * height * 4, nullptr, GL_STREAM_READ);
+		}
+		GLFunctions::glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	// without pixel buffers the read back blocks until the frame is done
+	if (!pixelBuffers[0])
+	{
+		readbackPixels.resize((size_t)width * height * 4);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, readbackPixels.data());
+		submit(readbackPixels.data(), true, SDL_GetPerformanceCounter());
+		return;
+	}
+
+	// the oldest buffer is needed again, its frame has long been rendered
+	if (readbacks - mapped == READBACK_BUFFERS)
+		readBack();
+
+	int index = readbacks % READBACK_BUFFERS;
+	GLFunctions::glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[index]);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	GLFunctions::glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	readbackTimes[index] = SDL_GetPerformanceCounter();
+	++readbacks;
+}
+
+void
+FrameCapture::
+capture(const unsigned char* pixels)
+{
+	submit(pixels, false, SDL_GetPerformanceCounter());
+}
+
+void
+FrameCapture::
+readBack()
+{
+	int index = mapped % READBACK_BUFFERS;
+	GLFunctions::glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[index]);
+	const unsigned char* pixels = static_cast<const unsigned char*>(GLFunctions::glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY));
+	if (pixels)
+	{
+		submit(pixels, true, readbackTimes[index]);
+		GLFunctions::glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	GLFunctions::glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	++mapped;
+}
+
+void
+FrameCapture::
+submit(const unsigned char* pixels, bool bottomUp, Uint64 time)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	int number = captured++;
+	if (freeFrames.empty())
+	{
+		if (policy == Drop)
+		{
+			++dropped;
+			return;
+		}
+
+		freed.wait(lock, [this] { return !freeFrames.empty(); });
+	}
+
+	Frame* frame = freeFrames.back();
+	freeFrames.pop_back();
+	lock.unlock();
+
+	std::copy(pixels, pixels + frame->pixels.size(), frame->pixels.begin());
+	frame->number = number;
+	frame->bottomUp = bottomUp;
+	frame->time = time;
+
+	lock.lock();
+	queue.push_back(frame);
+	queued.notify_one();
+}
+
+void
+FrameCapture::
+flush()
+{
+	while (mapped < readbacks)
+		readBack();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	freed.wait(lock, [this] { return freeFrames.size() == frames.size(); });
+}
+
+FrameCapture::Stats
+FrameCapture::
+getStats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	Stats stats;
+	stats.captured = captured;
+	stats.written = written;
+	stats.dropped = dropped;
+	stats.averageLatency = written ? totalLatency / written : 0;
+	stats.maxLatency = maxLatency;
+	return stats;
+}
+
+void
+FrameCapture::
+encode()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;)
+	{
+		queued.wait(lock, [this] { return stopping || !queue.empty(); });
+		if (queue.empty())
+			return;
+
+		Frame* frame = queue.front();
+		queue.pop_front();
+		lock.unlock();
+
+		bool success = write(*frame);
+		double latency = double(SDL_GetPerformanceCounter() - frame->time) * 1000 / SDL_GetPerformanceFrequency();
+
+		lock.lock();
+		if (success)
+		{
+			++written;
+			totalLatency += latency;
+			maxLatency = std::max(maxLatency, latency);
+		}
+		freeFrames.push_back(frame);
+		freed.notify_all();
+	}
+}
+
+bool
+FrameCapture::
+write(Frame& frame)
+{
+	// GL reads back the bottom row first
+	size_t stride = (size_t)width * 4;
+	if (frame.bottomUp)
+		for (int row = 0; row < height / 2; ++row)
+			std::swap_ranges(frame.pixels.begin() + row * stride, frame.pixels.begin() + (row + 1) * stride, frame.pixels.begin() + (height - 1 - row) * stride);
+
+	char number[16];
+	snprintf(number, sizeof(number), "%06d", frame.number);
+	std::string path = prefix + number + (format == PNG ? ".png" : ".rgba");
+
+	bool success = false;
+	if (format == PNG)
+	{
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+		SDL_Surface* surface = SDL_CreateRGBSurfaceFrom(frame.pixels.data(), width, height, 32, (int)stride, 0xff000000, 0x00ff0000, 0x0000ff00, 0x000000ff);
+#else
+		SDL_Surface* surface = SDL_CreateRGBSurfaceFrom(frame.pixels.data(), width, height, 32, (int)stride, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
+#endif
+		success = surface && IMG_SavePNG(surface, path.c_str()) == 0;
+		SDL_FreeSurface(surface);
+	}
+	else if (FILE* file = fopen(path.c_str(), "wb"))
+	{
+		success = fwrite(frame.pixels.data(), 1, frame.pixels.size(), file) == frame.pixels.size();
+		success = fclose(file) == 0 && success;
+	}
+
+	if (!success)
+		fprintf(stderr, "WARNING: Could not write %s!\n", path.c_str());
+
+	return success;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SDL/SDL.h"
+#include "SDL/SDL_opengl.h"
+
+// Records frames as a numbered image sequence. Files are written by a
+// background encoder thread fed through a bounded queue, so the main loop
+// only pays for a copy. GL frames are read back into a ring of pixel buffer
+// objects and mapped a few frames later, once the GPU is done with them,
+// so capturing never waits for the frame to finish rendering.
+//
+// File names are the prefix followed by the frame number, e.g. prefix
+// "capture/frame" gives capture/frame000000.png. Frames that are dropped
+// leave a gap in the numbering.
+class FrameCapture
+{
+public:
+	enum Format
+	{
+		// 8-bit RGBA PNG files
+		PNG,
+		// headerless RGBA files, top row first
+		Raw
+	};
+
+	// What capture does when the encoder falls behind and the queue is full
+	enum Policy
+	{
+		// skip the frame and count it as dropped
+		Drop,
+		// wait for the encoder, slowing the main loop down
+		Block
+	};
+
+	struct Stats
+	{
+		int captured;
+		int written;
+		int dropped;
+		// time from capture to written file, in milliseconds
+		double averageLatency;
+		double maxLatency;
+	};
+
+	// Frames in flight between glReadPixels and the copy to the queue
+	static const int READBACK_BUFFERS = 3;
+
+	FrameCapture(const std::string& prefix, int width, int height, Format format = PNG, Policy policy = Drop, int queueSize = 8);
+
+	// Writes out every frame still queued. After a GL capture, the context
+	// must still be current.
+	~FrameCapture();
+
+	// Reads back the GL back buffer; call after rendering, before swapping
+	void capture();
+	// Queues a frame from memory, RGBA top row first
+	void capture(const unsigned char* pixels);
+
+	// Waits for the frames being read back and queued to be written
+	void flush();
+
+	Stats getStats();
+
+private:
+	FrameCapture(const FrameCapture&);
+	FrameCapture& operator=(const FrameCapture&);
+
+	struct Frame
+	{
+		std::vector<unsigned char> pixels;
+		int number;
+		bool bottomUp;
+		Uint64 time;
+	};
+
+	void readBack();
+	void submit(const unsigned char* pixels, bool bottomUp, Uint64 time);
+	void encode();
+	bool write(Frame& frame);
+
+	std::string prefix;
+	int width;
+	int height;
+	Format format;
+	Policy policy;
+
+	GLuint pixelBuffers[READBACK_BUFFERS];
+	Uint64 readbackTimes[READBACK_BUFFERS];
+	int readbacks;
+	int mapped;
+	std::vector<unsigned char> readbackPixels;
+
+	std::vector<Frame> frames;
+	std::vector<Frame*> freeFrames;
+	std::deque<Frame*> queue;
+	std::mutex mutex;
+	std::condition_variable queued;
+	std::condition_variable freed;
+	std::thread encoder;
+	bool stopping;
+
+	int captured;
+	int written;
+	int dropped;
+	double totalLatency;
+	double maxLatency;
+};
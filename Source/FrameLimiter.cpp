@@ -0,0 +1,86 @@
+#include "FrameLimiter.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Initial guess for how long a 1 ms sleep takes
+	const double SLEEP_ESTIMATE = 0.002;
+
+	// Older measurements stop counting past this many
+	const int MAX_SLEEP_SAMPLES = 64;
+}
+
+FrameLimiter::
+FrameLimiter(float maxFPS)
+: frequency(SDL_GetPerformanceFrequency()),
+  next(0),
+  maxFPS(0),
+  sleepMean(SLEEP_ESTIMATE),
+  sleepVariance(0),
+  sleepCount(1)
+{
+	setMaxFPS(maxFPS);
+}
+
+void
+FrameLimiter::
+setMaxFPS(float value)
+{
+	maxFPS = std::max(value, 0.0f);
+	next = 0;
+}
+
+float
+FrameLimiter::
+getMaxFPS()
+{
+	return maxFPS;
+}
+
+void
+FrameLimiter::
+wait()
+{
+	if (maxFPS <= 0)
+		return;
+
+	Uint64 period = Uint64(frequency / maxFPS);
+	Uint64 now = SDL_GetPerformanceCounter();
+	if (next == 0 || now >= next + period)
+	{
+		next = now + period;
+		return;
+	}
+
+	if (now < next)
+		sleep(double(next - now) / frequency);
+
+	while (SDL_GetPerformanceCounter() < next)
+		;
+
+	next += period;
+}
+
+void
+FrameLimiter::
+sleep(double remaining)
+{
+	// Sleep while even a slow slice, mean plus a standard deviation, would
+	// wake up before the deadline
+	while (remaining > sleepMean + std::sqrt(sleepVariance))
+	{
+		Uint64 start = SDL_GetPerformanceCounter();
+		SDL_Delay(1);
+		double slept = double(SDL_GetPerformanceCounter() - start) / frequency;
+		remaining -= slept;
+
+		// running mean and variance, which favor recent samples once the
+		// count is capped
+		sleepCount = std::min(sleepCount + 1, MAX_SLEEP_SAMPLES);
+		double delta = slept - sleepMean;
+		sleepMean += delta / sleepCount;
+		sleepVariance += (delta * (slept - sleepMean) - sleepVariance) / sleepCount;
+	}
+}
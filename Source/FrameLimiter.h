@@ -0,0 +1,32 @@
+#pragma once
+
+#include "SDL/SDL.h"
+
+// Caps the frame rate without burning a core: waits for the next frame by
+// sleeping in 1 ms slices while the remaining time comfortably covers
+// one, then spins for the last fraction of a millisecond. How long a slice
+// really takes is learned as it goes, since the scheduler often oversleeps.
+class FrameLimiter
+{
+	Uint64 frequency;
+	Uint64 next;
+	float maxFPS;
+
+	// Running mean and variance of how long a 1 ms sleep takes, in seconds
+	double sleepMean;
+	double sleepVariance;
+	int sleepCount;
+
+	void sleep(double remaining);
+
+public:
+	FrameLimiter(float maxFPS = 0);
+
+	// Frames per second to hold to, 0 for no limit
+	void setMaxFPS(float value);
+	float getMaxFPS();
+
+	// Blocks until the next frame is due. A frame that runs late starts a
+	// new schedule rather than letting the next ones catch up.
+	void wait();
+};
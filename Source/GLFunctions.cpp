@@ -0,0 +1,109 @@
+#include "GLFunctions.h"
+
+#include <cstdio>
+
+PFNGLGENBUFFERSPROC GLFunctions::glGenBuffers = nullptr;
+PFNGLDELETEBUFFERSPROC GLFunctions::glDeleteBuffers = nullptr;
+PFNGLBINDBUFFERPROC GLFunctions::glBindBuffer = nullptr;
+PFNGLBUFFERDATAPROC GLFunctions::glBufferData = nullptr;
+PFNGLBUFFERSUBDATAPROC GLFunctions::glBufferSubData = nullptr;
+PFNGLMAPBUFFERPROC GLFunctions::glMapBuffer = nullptr;
+PFNGLUNMAPBUFFERPROC GLFunctions::glUnmapBuffer = nullptr;
+PFNGLCREATESHADERPROC GLFunctions::glCreateShader = nullptr;
+PFNGLDELETESHADERPROC GLFunctions::glDeleteShader = nullptr;
+PFNGLSHADERSOURCEPROC GLFunctions::glShaderSource = nullptr;
+PFNGLCOMPILESHADERPROC GLFunctions::glCompileShader = nullptr;
+PFNGLGETSHADERIVPROC GLFunctions::glGetShaderiv = nullptr;
+PFNGLGETSHADERINFOLOGPROC GLFunctions::glGetShaderInfoLog = nullptr;
+PFNGLCREATEPROGRAMPROC GLFunctions::glCreateProgram = nullptr;
+PFNGLDELETEPROGRAMPROC GLFunctions::glDeleteProgram = nullptr;
+PFNGLATTACHSHADERPROC GLFunctions::glAttachShader = nullptr;
+PFNGLBINDATTRIBLOCATIONPROC GLFunctions::glBindAttribLocation = nullptr;
+PFNGLLINKPROGRAMPROC GLFunctions::glLinkProgram = nullptr;
+PFNGLGETPROGRAMIVPROC GLFunctions::glGetProgramiv = nullptr;
+PFNGLGETPROGRAMINFOLOGPROC GLFunctions::glGetProgramInfoLog = nullptr;
+PFNGLUSEPROGRAMPROC GLFunctions::glUseProgram = nullptr;
+PFNGLGETUNIFORMLOCATIONPROC GLFunctions::glGetUniformLocation = nullptr;
+PFNGLUNIFORM1FPROC GLFunctions::glUniform1f = nullptr;
+PFNGLUNIFORM2FPROC GLFunctions::glUniform2f = nullptr;
+PFNGLUNIFORM4FPROC GLFunctions::glUniform4f = nullptr;
+PFNGLUNIFORM4FVPROC GLFunctions::glUniform4fv = nullptr;
+PFNGLENABLEVERTEXATTRIBARRAYPROC GLFunctions::glEnableVertexAttribArray = nullptr;
+PFNGLDISABLEVERTEXATTRIBARRAYPROC GLFunctions::glDisableVertexAttribArray = nullptr;
+PFNGLVERTEXATTRIBPOINTERPROC GLFunctions::glVertexAttribPointer = nullptr;
+
+namespace
+{
+	template <typename T>
+	void
+	lookup(T& function, const char* name)
+	{
+		function = reinterpret_cast<T>(SDL_GL_GetProcAddress(name));
+	}
+}
+
+void
+GLFunctions::
+load()
+{
+	lookup(glGenBuffers, "glGenBuffers");
+	lookup(glDeleteBuffers, "glDeleteBuffers");
+	lookup(glBindBuffer, "glBindBuffer");
+	lookup(glBufferData, "glBufferData");
+	lookup(glBufferSubData, "glBufferSubData");
+	lookup(glMapBuffer, "glMapBuffer");
+	lookup(glUnmapBuffer, "glUnmapBuffer");
+
+	lookup(glCreateShader, "glCreateShader");
+	lookup(glDeleteShader, "glDeleteShader");
+	lookup(glShaderSource, "glShaderSource");
+	lookup(glCompileShader, "glCompileShader");
+	lookup(glGetShaderiv, "glGetShaderiv");
+	lookup(glGetShaderInfoLog, "glGetShaderInfoLog");
+	lookup(glCreateProgram, "glCreateProgram");
+	lookup(glDeleteProgram, "glDeleteProgram");
+	lookup(glAttachShader, "glAttachShader");
+	lookup(glBindAttribLocation, "glBindAttribLocation");
+	lookup(glLinkProgram, "glLinkProgram");
+	lookup(glGetProgramiv, "glGetProgramiv");
+	lookup(glGetProgramInfoLog, "glGetProgramInfoLog");
+	lookup(glUseProgram, "glUseProgram");
+	lookup(glGetUniformLocation, "glGetUniformLocation");
+	lookup(glUniform1f, "glUniform1f");
+	lookup(glUniform2f, "glUniform2f");
+	lookup(glUniform4f, "glUniform4f");
+	lookup(glUniform4fv, "glUniform4fv");
+	lookup(glEnableVertexAttribArray, "glEnableVertexAttribArray");
+	lookup(glDisableVertexAttribArray, "glDisableVertexAttribArray");
+	lookup(glVertexAttribPointer, "glVertexAttribPointer");
+}
+
+bool
+GLFunctions::
+hasBufferObjects()
+{
+	return glGenBuffers && glDeleteBuffers && glBindBuffer && glBufferData && glBufferSubData;
+}
+
+bool
+GLFunctions::
+hasPixelBuffers()
+{
+	// the entry points are the buffer object ones, only the targets are new
+	int major = 0, minor = 0;
+	const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+	if (version)
+		sscanf(version, "%d.%d", &major, &minor);
+
+	return hasBufferObjects() && glMapBuffer && glUnmapBuffer
+		&& (major > 2 || (major == 2 && minor >= 1) || SDL_GL_ExtensionSupported("GL_ARB_pixel_buffer_object"));
+}
+
+bool
+GLFunctions::
+hasShaders()
+{
+	return glCreateShader && glDeleteShader && glShaderSource && glCompileShader && glGetShaderiv && glGetShaderInfoLog && glCreateProgram && glDeleteProgram && glAttachShader && glBindAttribLocation
+		&& glLinkProgram && glGetProgramiv && glGetProgramInfoLog && glUseProgram && glGetUniformLocation && glUniform1f && glUniform2f && glUniform4f && glUniform4fv
+		&& glEnableVertexAttribArray && glDisableVertexAttribArray && glVertexAttribPointer;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "SDL/SDL.h"
+#include "SDL/SDL_opengl.h"
+
+// OpenGL entry points newer than 1.1. Windows only exports 1.1 from its GL
+// library, so these are looked up through SDL once a context is current.
+class GLFunctions
+{
+public:
+	// Looks up every entry point; call after the GL context is created
+	static void load();
+
+	// Vertex buffer objects (GL 1.5)
+	static bool hasBufferObjects();
+
+	static PFNGLGENBUFFERSPROC glGenBuffers;
+	static PFNGLDELETEBUFFERSPROC glDeleteBuffers;
+	static PFNGLBINDBUFFERPROC glBindBuffer;
+	static PFNGLBUFFERDATAPROC glBufferData;
+	static PFNGLBUFFERSUBDATAPROC glBufferSubData;
+
+	// Pixel buffer objects (GL 2.1), for asynchronous readback
+	static bool hasPixelBuffers();
+
+	static PFNGLMAPBUFFERPROC glMapBuffer;
+	static PFNGLUNMAPBUFFERPROC glUnmapBuffer;
+
+	// GLSL programs and generic vertex attributes (GL 2.0)
+	static bool hasShaders();
+
+	static PFNGLCREATESHADERPROC glCreateShader;
+	static PFNGLDELETESHADERPROC glDeleteShader;
+	static PFNGLSHADERSOURCEPROC glShaderSource;
+	static PFNGLCOMPILESHADERPROC glCompileShader;
+	static PFNGLGETSHADERIVPROC glGetShaderiv;
+	static PFNGLGETSHADERINFOLOGPROC glGetShaderInfoLog;
+	static PFNGLCREATEPROGRAMPROC glCreateProgram;
+	static PFNGLDELETEPROGRAMPROC glDeleteProgram;
+	static PFNGLATTACHSHADERPROC glAttachShader;
+	static PFNGLBINDATTRIBLOCATIONPROC glBindAttribLocation;
+	static PFNGLLINKPROGRAMPROC glLinkProgram;
+	static PFNGLGETPROGRAMIVPROC glGetProgramiv;
+	static PFNGLGETPROGRAMINFOLOGPROC glGetProgramInfoLog;
+	static PFNGLUSEPROGRAMPROC glUseProgram;
+	static PFNGLGETUNIFORMLOCATIONPROC glGetUniformLocation;
+	static PFNGLUNIFORM1FPROC glUniform1f;
+	static PFNGLUNIFORM2FPROC glUniform2f;
+	static PFNGLUNIFORM4FPROC glUniform4f;
+	static PFNGLUNIFORM4FVPROC glUniform4fv;
+	static PFNGLENABLEVERTEXATTRIBARRAYPROC glEnableVertexAttribArray;
+	static PFNGLDISABLEVERTEXATTRIBARRAYPROC glDisableVertexAttribArray;
+	static PFNGLVERTEXATTRIBPOINTERPROC glVertexAttribPointer;
+};
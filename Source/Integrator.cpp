@@ -0,0 +1,256 @@
+#include "Integrator.h"
+
+#include <cmath>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define INTEGRATOR_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC lets any function use AVX intrinsics, GCC and Clang need to be told
+#if defined(__GNUC__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+namespace
+{
+	// Cephes style range reduction to [-pi/4, pi/4], with pi/2 split in three
+	// parts so that the reduction stays exact for moderate angles
+	const float TWO_OVER_PI = 0.636619772367581343f;
+	const float PI_OVER_2_A = 1.5703125f;
+	const float PI_OVER_2_B = 4.837512969970703125e-4f;
+	const float PI_OVER_2_C = 7.54978995489188216e-8f;
+
+	const float SIN_1 = -1.9515295891e-4f;
+	const float SIN_2 = 8.3321608736e-3f;
+	const float SIN_3 = -1.6666654611e-1f;
+	const float COS_1 = 2.443315711809948e-5f;
+	const float COS_2 = -1.388731625493765e-3f;
+	const float COS_3 = 4.166664568298827e-2f;
+
+	void
+	sincosScalar(const float* radians, float* sines, float* cosines, int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			float x = radians[i];
+			float j = std::floor(x * TWO_OVER_PI + 0.5f);
+			int quadrant = int(j) & 3;
+			float y = ((x - j * PI_OVER_2_A) - j * PI_OVER_2_B) - j * PI_OVER_2_C;
+			float z = y * y;
+
+			float s = ((SIN_1 * z + SIN_2) * z + SIN_3) * z * y + y;
+			float c = ((COS_1 * z + COS_2) * z + COS_3) * z * z - 0.5f * z + 1.0f;
+
+			float sine = (quadrant & 1) ? c : s;
+			float cosine = (quadrant & 1) ? s : c;
+			sines[i] = (quadrant & 2) ? -sine : sine;
+			cosines[i] = ((quadrant + 1) & 2) ? -cosine : cosine;
+		}
+	}
+
+	void
+	integrateScalar(float* x, float* y, float* vx, float* vy, float* age, const float* gravity, int begin, int end, float dt)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			age[i] += dt;
+			vy[i] += gravity[i] * dt;
+			x[i] += vx[i] * dt;
+			y[i] += vy[i] * dt;
+		}
+	}
+
+#if defined(INTEGRATOR_X86)
+	void
+	integrateSSE2(float* x, float* y, float* vx, float* vy, float* age, const float* gravity, int count, float dt)
+	{
+		const __m128 t = _mm_set1_ps(dt);
+		int i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 newVY = _mm_add_ps(_mm_loadu_ps(vy + i), _mm_mul_ps(_mm_loadu_ps(gravity + i), t));
+			_mm_storeu_ps(age + i, _mm_add_ps(_mm_loadu_ps(age + i), t));
+			_mm_storeu_ps(vy + i, newVY);
+			_mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i), _mm_mul_ps(_mm_loadu_ps(vx + i), t)));
+			_mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(newVY, t)));
+		}
+		integrateScalar(x, y, vx, vy, age, gravity, i, count, dt);
+	}
+
+	void
+	sincosSSE2(const float* radians, float* sines, float* cosines, int count)
+	{
+		const __m128 twoOverPi = _mm_set1_ps(TWO_OVER_PI);
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 signBit = _mm_set1_ps(-0.0f);
+		const __m128i oneBit = _mm_set1_epi32(1);
+		const __m128i twoBit = _mm_set1_epi32(2);
+
+		int i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(radians + i);
+
+			// floor(x * 2 / pi + 0.5), correcting the truncation of negative values
+			__m128 t = _mm_add_ps(_mm_mul_ps(x, twoOverPi), half);
+			__m128i truncated = _mm_cvttps_epi32(t);
+			__m128 j = _mm_cvtepi32_ps(truncated);
+			__m128 overshoot = _mm_cmpgt_ps(j, t);
+			j = _mm_sub_ps(j, _mm_and_ps(overshoot, one));
+			__m128i quadrant = _mm_cvttps_epi32(j);
+
+			__m128 y = _mm_sub_ps(x, _mm_mul_ps(j, _mm_set1_ps(PI_OVER_2_A)));
+			y = _mm_sub_ps(y, _mm_mul_ps(j, _mm_set1_ps(PI_OVER_2_B)));
+			y = _mm_sub_ps(y, _mm_mul_ps(j, _mm_set1_ps(PI_OVER_2_C)));
+			__m128 z = _mm_mul_ps(y, y);
+
+			__m128 s = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SIN_1), z), _mm_set1_ps(SIN_2));
+			s = _mm_add_ps(_mm_mul_ps(s, z), _mm_set1_ps(SIN_3));
+			s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, z), y), y);
+
+			__m128 c = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(COS_1), z), _mm_set1_ps(COS_2));
+			c = _mm_add_ps(_mm_mul_ps(c, z), _mm_set1_ps(COS_3));
+			c = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_mul_ps(c, z), z), _mm_mul_ps(half, z)), one);
+
+			// odd quadrants swap sine and cosine, then the signs follow the quadrant
+			__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, oneBit), oneBit));
+			__m128 sine = _mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s));
+			__m128 cosine = _mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c));
+
+			__m128 sineSign = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, twoBit), twoBit));
+			__m128 cosineSign = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_add_epi32(quadrant, oneBit), twoBit), twoBit));
+			_mm_storeu_ps(sines + i, _mm_xor_ps(sine, _mm_and_ps(sineSign, signBit)));
+			_mm_storeu_ps(cosines + i, _mm_xor_ps(cosine, _mm_and_ps(cosineSign, signBit)));
+		}
+		sincosScalar(radians, sines, cosines, i, count);
+	}
+
+	TARGET_AVX2
+	void
+	integrateAVX2(float* x, float* y, float* vx, float* vy, float* age, const float* gravity, int count, float dt)
+	{
+		const __m256 t = _mm256_set1_ps(dt);
+		int i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 newVY = _mm256_add_ps(_mm256_loadu_ps(vy + i), _mm256_mul_ps(_mm256_loadu_ps(gravity + i), t));
+			_mm256_storeu_ps(age + i, _mm256_add_ps(_mm256_loadu_ps(age + i), t));
+			_mm256_storeu_ps(vy + i, newVY);
+			_mm256_storeu_ps(x + i, _mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_mul_ps(_mm256_loadu_ps(vx + i), t)));
+			_mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(newVY, t)));
+		}
+		_mm256_zeroupper();
+		integrateScalar(x, y, vx, vy, age, gravity, i, count, dt);
+	}
+
+	bool
+	hasAVX2()
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+
+		// the OS must also save the YMM registers on context switches
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+			return false;
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+#endif
+}
+
+Integrator::ISA
+Integrator::
+getSupportedISA()
+{
+#if defined(INTEGRATOR_X86)
+	static const ISA supported = hasAVX2() ? AVX2 : SSE2;
+	return supported;
+#else
+	return Scalar;
+#endif
+}
+
+const char*
+Integrator::
+getName(ISA isa)
+{
+	switch (isa)
+	{
+	case SSE2:
+		return "SSE2";
+	case AVX2:
+		return "AVX2";
+	default:
+		return "Scalar";
+	}
+}
+
+void
+Integrator::
+integrate(float* x, float* y, float* vx, float* vy, float* age, const float* gravity, int count, float deltaTime)
+{
+	integrate(getSupportedISA(), x, y, vx, vy, age, gravity, count, deltaTime);
+}
+
+void
+Integrator::
+integrate(ISA isa, float* x, float* y, float* vx, float* vy, float* age, const float* gravity, int count, float deltaTime)
+{
+	switch (isa)
+	{
+#if defined(INTEGRATOR_X86)
+	case AVX2:
+		integrateAVX2(x, y, vx, vy, age, gravity, count, deltaTime);
+		break;
+	case SSE2:
+		integrateSSE2(x, y, vx, vy, age, gravity, count, deltaTime);
+		break;
+#endif
+	default:
+		integrateScalar(x, y, vx, vy, age, gravity, 0, count, deltaTime);
+		break;
+	}
+}
+
+void
+Integrator::
+sincos(const float* radians, float* sines, float* cosines, int count)
+{
+	sincos(getSupportedISA(), radians, sines, cosines, count);
+}
+
+void
+Integrator::
+sincos(ISA isa, const float* radians, float* sines, float* cosines, int count)
+{
+	switch (isa)
+	{
+#if defined(INTEGRATOR_X86)
+	case AVX2:
+	case SSE2:
+		sincosSSE2(radians, sines, cosines, count);
+		break;
+#endif
+	default:
+		sincosScalar(radians, sines, cosines, 0, count);
+		break;
+	}
+}
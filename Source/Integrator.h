@@ -0,0 +1,31 @@
+#pragma once
+
+// Batch kernels that advance particles stored as separate contiguous arrays.
+// The instruction set is picked once at runtime from what the CPU supports;
+// every variant produces the same results as the scalar one.
+class Integrator
+{
+public:
+	enum ISA
+	{
+		Scalar,
+		SSE2,
+		AVX2
+	};
+
+	// Best instruction set supported by this CPU
+	static ISA getSupportedISA();
+	static const char* getName(ISA isa);
+
+	// Applies age += dt, vy += gravity * dt, position += velocity * dt to
+	// count particles using the best supported instruction set.
+	static void integrate(float* x, float* y, float* vx, float* vy, float* age, const float* gravity, int count, float deltaTime);
+
+	// Same, forcing a specific instruction set (which must be supported).
+	static void integrate(ISA isa, float* x, float* y, float* vx, float* vy, float* age, const float* gravity, int count, float deltaTime);
+
+	// Computes the sine and cosine of count angles given in radians. Accurate
+	// to a few float ulps for angles within a few turns of zero.
+	static void sincos(const float* radians, float* sines, float* cosines, int count);
+	static void sincos(ISA isa, const float* radians, float* sines, float* cosines, int count);
+};
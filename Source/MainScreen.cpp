@@ -1,8 +1,11 @@
 #include "MainScreen.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 #include "StringUtil.h"
+#include "ThreadPool.h"
 
 MainScreen::
 MainScreen(const std::string& title, SDL_Window* pwindow, int rwidth, int rheight)
@@ -19,7 +22,21 @@ MainScreen(const std::string& title, SDL_Window* pwindow, int rwidth, int rheigh
 	spread(60),
 	minSpeed(160),
 	maxSpeed(220),
-	gravity(196)
+	gravity(196),
+	collisions(0),
+	interaction(0),
+	particleForces(false),
+	openingAngle(0.5f),
+	threads(ThreadPool::getHardwareThreadCount()),
+	renderer(2),
+	stepTime(22),
+	interpolate(true),
+	maxSteps(5),
+	overload(0),
+	throttle(true),
+	maxFPS(0),
+	vsync(1),
+	idle(true)
 {
 	{
 		auto& window = add<nanogui::Window>("Settings");
@@ -47,6 +64,42 @@ MainScreen(const std::string& title, SDL_Window* pwindow, int rwidth, int rheigh
 			textFPS->setValue("0");
 		}
 
+		// Simulation steps per second
+		{
+			panel.add<nanogui::Label>("Sim Rate :", "sans-bold");
+			textSimRate = &panel.add<nanogui::TextBox>();
+			textSimRate->setFontSize(16);
+			textSimRate->setFixedSize(Eigen::Vector2i(100, 20));
+			textSimRate->setValue("0");
+		}
+
+		// Steps run, skipped and throttled by the last batch
+		{
+			panel.add<nanogui::Label>("Steps :", "sans-bold");
+			textSteps = &panel.add<nanogui::TextBox>();
+			textSteps->setFontSize(16);
+			textSteps->setFixedSize(Eigen::Vector2i(100, 20));
+			textSteps->setValue("0 / 0 / 0");
+		}
+
+		// Update Time
+		{
+			panel.add<nanogui::Label>("Update (ms) :", "sans-bold");
+			textUpdateTime = &panel.add<nanogui::TextBox>();
+			textUpdateTime->setFontSize(16);
+			textUpdateTime->setFixedSize(Eigen::Vector2i(100, 20));
+			textUpdateTime->setValue("0");
+		}
+
+		// Allocations
+		{
+			panel.add<nanogui::Label>("Allocations :", "sans-bold");
+			textAllocations = &panel.add<nanogui::TextBox>();
+			textAllocations->setFontSize(16);
+			textAllocations->setFixedSize(Eigen::Vector2i(100, 20));
+			textAllocations->setValue("0");
+		}
+
 		// Emission
 		{
 			panel.add<nanogui::Label>("Emission: ", "sans-bold");
@@ -103,22 +156,23 @@ MainScreen(const std::string& title, SDL_Window* pwindow, int rwidth, int rheigh
 
 		// Max Particles
 		{
+			// logarithmic slider, the range goes up to millions
 			const float MIN_VALUE = 0;
-			const float MAX_VALUE = 65535;
+			const float MAX_VALUE = 16777216;
 			const float INITIAL_VALUE = maxParticles;
 
 			panel.add<nanogui::Label>("Max Particles: ", "sans-bold");
 			auto& area = panel.add<Widget>().withLayout<nanogui::BoxLayout>(nanogui::Orientation::Horizontal, nanogui::Alignment::Maximum, 0, 16);
-			auto& textBox = area.add<nanogui::TextBox>(std::format("%g", INITIAL_VALUE));
+			auto& textBox = area.add<nanogui::TextBox>(std::format("%.0f", INITIAL_VALUE));
 			textBox.setAlignment(nanogui::TextBox::Alignment::Right);
 			textBox.setEditable(true);
 			textBox.setFontSize(16);
 			textBox.setFixedWidth(100);
 			textBox.setDefaultValue("0");
-			textBox.setFormat("^([0-9]{1,4}|[1-5][0-9]{4}|6[0-4][0-9]{3}|65[0-4][0-9]{2}|655[0-2][0-9]|6553[0-5])$");
+			textBox.setFormat("^([0-9]{1,7}|1[0-5][0-9]{6}|16[0-6][0-9]{5}|167[0-6][0-9]{4}|1677[0-6][0-9]{3}|16777[01][0-9]{2}|167772(0[0-9]|1[0-6]))$");
 
 			auto& slider = area.add<nanogui::Slider>();
-			slider.setValue((INITIAL_VALUE - MIN_VALUE) / (MAX_VALUE - MIN_VALUE));
+			slider.setValue(std::log1p(INITIAL_VALUE - MIN_VALUE) / std::log1p(MAX_VALUE - MIN_VALUE));
 			slider.setFixedSize(Eigen::Vector2i(100, 16));
 
 			textBox.setCallback([=, &slider](const std::string& s)
@@ -126,7 +180,7 @@ MainScreen(const std::string& title, SDL_Window* pwindow, int rwidth, int rheigh
 				try
 				{
 					float value = s.empty() ? 0 : std::stod(s);
-					slider.setValue((value - MIN_VALUE) / (MAX_VALUE - MIN_VALUE));
+					slider.setValue(std::log1p(value - MIN_VALUE) / std::log1p(MAX_VALUE - MIN_VALUE));
 					setMaxParticles(value);
 					return true;
 				}
@@ -139,7 +193,7 @@ MainScreen(const std::string& title, SDL_Window* pwindow, int rwidth, int rheigh
 
 			slider.setCallback([=, &textBox](float value)
 			{
-				int k = int(MIN_VALUE + value * (MAX_VALUE - MIN_VALUE));
+				int k = int(MIN_VALUE + std::round(std::expm1(value * std::log1p(MAX_VALUE - MIN_VALUE))));
 				textBox.setValue(std::format("%d", k));
 				setMaxParticles(k);
 			});
@@ -246,8 +300,9 @@ MainScreen(const std::string& title, SDL_Window* pwindow, int rwidth, int rheigh
 
 		// Rate
 		{
+			// logarithmic slider, filling millions of particles takes high rates
 			const float MIN_VALUE = 0;
-			const float MAX_VALUE = 1000;
+			const float MAX_VALUE = 1000000;
 			const float INITIAL_VALUE = rate;
 
 			panel.add<nanogui::Label>("Rate: ", "sans-bold");
@@ -258,10 +313,10 @@ MainScreen(const std::string& title, SDL_Window* pwindow, int rwidth, int rheigh
 			textBox.setFontSize(16);
 			textBox.setFixedWidth(100);
 			textBox.setDefaultValue("0");
-			textBox.setFormat(R"(^0$|^(([0-9]|[1-9]([0-9]{0,2}))(\.[0-9]+)?)$|^1000$)");
+			textBox.setFormat(R"(^0$|^(([0-9]|[1-9]([0-9]{0,5}))(\.[0-9]+)?)$|^1000000$)");
 
 			auto& slider = area.add<nanogui::Slider>();
-			slider.setValue((INITIAL_VALUE - MIN_VALUE) / (MAX_VALUE - MIN_VALUE));
+			slider.setValue(std::log1p(INITIAL_VALUE - MIN_VALUE) / std::log1p(MAX_VALUE - MIN_VALUE));
 			slider.setFixedSize(Eigen::Vector2i(100, 16));
 
 			textBox.setCallback([=, &slider](const std::string& s)
@@ -269,7 +324,7 @@ MainScreen(const std::string& title, SDL_Window* pwindow, int rwidth, int rheigh
 				try
 				{
 					float value = s.empty() ? 0 : std::stod(s);
-					slider.setValue((value - MIN_VALUE) / (MAX_VALUE - MIN_VALUE));
+					slider.setValue(std::log1p(value - MIN_VALUE) / std::log1p(MAX_VALUE - MIN_VALUE));
 					setRate(value);
 					return true;
 				}
@@ -282,8 +337,8 @@ MainScreen(const std::string& title, SDL_Window* pwindow, int rwidth, int rheigh
 
 			slider.setCallback([=, &textBox](float value)
 			{
-				float k = MIN_VALUE + value * (MAX_VALUE - MIN_VALUE);
-				textBox.setValue(std::format("%g", k));
+				float k = MIN_VALUE + std::round(std::expm1(value * std::log1p(MAX_VALUE - MIN_VALUE)));
+				textBox.setValue(std::format("%.0f", k));
 				setRate(k);
 			});
 		}
@@ -551,6 +606,367 @@ MainScreen(const std::string& title, SDL_Window* pwindow, int rwidth, int rheigh
 				setGravity(k);
 			});
 		}
+
+		// Collisions
+		{
+			const float MIN_VALUE = 0;
+			const float MAX_VALUE = 8;
+			const float INITIAL_VALUE = collisions;
+
+			panel.add<nanogui::Label>("Collisions: ", "sans-bold");
+			auto& area = panel.add<Widget>().withLayout<nanogui::BoxLayout>(nanogui::Orientation::Horizontal, nanogui::Alignment::Maximum, 0, 16);
+			auto& textBox = area.add<nanogui::TextBox>(std::format("%g", INITIAL_VALUE));
+			textBox.setAlignment(nanogui::TextBox::Alignment::Right);
+			textBox.setEditable(true);
+			textBox.setFontSize(16);
+			textBox.setFixedWidth(100);
+			textBox.setDefaultValue("0");
+			textBox.setFormat("^[0-8]$");
+
+			auto& slider = area.add<nanogui::Slider>();
+			slider.setValue((INITIAL_VALUE - MIN_VALUE) / (MAX_VALUE - MIN_VALUE));
+			slider.setFixedSize(Eigen::Vector2i(100, 16));
+
+			textBox.setCallback([=, &slider](const std::string& s)
+			{
+				try
+				{
+					int value = s.empty() ? 0 : std::stoi(s);
+					slider.setValue((value - MIN_VALUE) / (MAX_VALUE - MIN_VALUE));
+					setCollisions(value);
+					return true;
+				}
+				catch (std::exception&)
+				{
+				}
+
+				return false;
+			});
+
+			slider.setCallback([=, &textBox](float value)
+			{
+				int k = int(MIN_VALUE + value * (MAX_VALUE - MIN_VALUE) + 0.5f);
+				textBox.setValue(std::format("%d", k));
+				setCollisions(k);
+			});
+		}
+
+		// Interaction
+		{
+			panel.add<nanogui::Label>("Interaction: ", "sans-bold");
+			auto& combo = panel.add<nanogui::ComboBox>(std::vector<std::string>{ "Off", "Gravity", "Electric" });
+			combo.setSelectedIndex(interaction);
+			combo.setFontSize(16);
+			combo.setFixedSize(Eigen::Vector2i(100, 20));
+			combo.setCallback([=](int index)
+			{
+				setInteraction(index);
+			});
+		}
+
+		// Particle Forces
+		{
+			panel.add<nanogui::Label>("Particle Forces: ", "sans-bold");
+			panel.add<nanogui::CheckBox>("", [=](bool state)
+			{
+				setParticleForces(state);
+			})
+			.withChecked(particleForces)
+			.withFontSize(16);
+		}
+
+		// Opening Angle
+		{
+			const float MIN_VALUE = 0;
+			const float MAX_VALUE = 1.5f;
+			const float INITIAL_VALUE = openingAngle;
+
+			panel.add<nanogui::Label>("Opening Angle: ", "sans-bold");
+			auto& area = panel.add<Widget>().withLayout<nanogui::BoxLayout>(nanogui::Orientation::Horizontal, nanogui::Alignment::Maximum, 0, 16);
+			auto& textBox = area.add<nanogui::TextBox>(std::format("%g", INITIAL_VALUE));
+			textBox.setAlignment(nanogui::TextBox::Alignment::Right);
+			textBox.setEditable(true);
+			textBox.setFontSize(16);
+			textBox.setFixedWidth(100);
+			textBox.setDefaultValue("0.5");
+			textBox.setFormat(R"(^(0(\.[0-9]+)?|1(\.[0-4][0-9]*)?|1\.50*)$)");
+
+			auto& slider = area.add<nanogui::Slider>();
+			slider.setValue((INITIAL_VALUE - MIN_VALUE) / (MAX_VALUE - MIN_VALUE));
+			slider.setFixedSize(Eigen::Vector2i(100, 16));
+
+			textBox.setCallback([=, &slider](const std::string& s)
+			{
+				try
+				{
+					float value = s.empty() ? 0.5f : std::stod(s);
+					slider.setValue((value - MIN_VALUE) / (MAX_VALUE - MIN_VALUE));
+					setOpeningAngle(value);
+					return true;
+				}
+				catch (std::exception&)
+				{
+				}
+
+				return false;
+			});
+
+			slider.setCallback([=, &textBox](float value)
+			{
+				float k = MIN_VALUE + value * (MAX_VALUE - MIN_VALUE);
+				textBox.setValue(std::format("%g", k));
+				setOpeningAngle(k);
+			});
+		}
+
+		// Threads
+		{
+			const float MIN_VALUE = 1;
+			const float MAX_VALUE = ThreadPool::getHardwareThreadCount();
+			const float INITIAL_VALUE = threads;
+
+			panel.add<nanogui::Label>("Threads: ", "sans-bold");
+			auto& area = panel.add<Widget>().withLayout<nanogui::BoxLayout>(nanogui::Orientation::Horizontal, nanogui::Alignment::Maximum, 0, 16);
+			auto& textBox = area.add<nanogui::TextBox>(std::format("%g", INITIAL_VALUE));
+			textBox.setAlignment(nanogui::TextBox::Alignment::Right);
+			textBox.setEditable(true);
+			textBox.setFontSize(16);
+			textBox.setFixedWidth(100);
+			textBox.setDefaultValue("1");
+			textBox.setFormat("^[1-9][0-9]{0,2}$");
+
+			auto& slider = area.add<nanogui::Slider>();
+			slider.setValue(MAX_VALUE > MIN_VALUE ? (INITIAL_VALUE - MIN_VALUE) / (MAX_VALUE - MIN_VALUE) : 1);
+			slider.setFixedSize(Eigen::Vector2i(100, 16));
+
+			textBox.setCallback([=, &slider](const std::string& s)
+			{
+				try
+				{
+					// no more threads than the slider goes up to
+					int value = std::min(std::max(s.empty() ? 1 : std::stoi(s), (int)MIN_VALUE), (int)MAX_VALUE);
+					slider.setValue(MAX_VALUE > MIN_VALUE ? (value - MIN_VALUE) / (MAX_VALUE - MIN_VALUE) : 1);
+					setThreads(value);
+					return true;
+				}
+				catch (std::exception&)
+				{
+				}
+
+				return false;
+			});
+
+			slider.setCallback([=, &textBox](float value)
+			{
+				int k = int(MIN_VALUE + value * (MAX_VALUE - MIN_VALUE) + 0.5f);
+				textBox.setValue(std::format("%d", k));
+				setThreads(k);
+			});
+		}
+
+		// Renderer
+		{
+			panel.add<nanogui::Label>("Renderer: ", "sans-bold");
+			auto& combo = panel.add<nanogui::ComboBox>(std::vector<std::string>{ "Immediate", "Vertex Array", "Buffer Object", "Shader", "Packed Shader" });
+			combo.setSelectedIndex(renderer);
+			combo.setFontSize(16);
+			combo.setFixedSize(Eigen::Vector2i(100, 20));
+			combo.setCallback([=](int index)
+			{
+				setRenderer(index);
+			});
+		}
+
+		// Step Time
+		{
+			const float MIN_VALUE = 5;
+			const float MAX_VALUE = 100;
+			const float INITIAL_VALUE = stepTime;
+
+			panel.add<nanogui::Label>("Step (ms): ", "sans-bold");
+			auto& area = panel.add<Widget>().withLayout<nanogui::BoxLayout>(nanogui::Orientation::Horizontal, nanogui::Alignment::Maximum, 0, 16);
+			auto& textBox = area.add<nanogui::TextBox>(std::format("%g", INITIAL_VALUE));
+			textBox.setAlignment(nanogui::TextBox::Alignment::Right);
+			textBox.setEditable(true);
+			textBox.setFontSize(16);
+			textBox.setFixedWidth(100);
+			textBox.setDefaultValue(std::format("%g", INITIAL_VALUE));
+			textBox.setFormat(R"(^([5-9]|[1-9][0-9])(\.[0-9]+)?$|^100$)");
+
+			auto& slider = area.add<nanogui::Slider>();
+			slider.setValue((INITIAL_VALUE - MIN_VALUE) / (MAX_VALUE - MIN_VALUE));
+			slider.setFixedSize(Eigen::Vector2i(100, 16));
+
+			textBox.setCallback([=, &slider](const std::string& s)
+			{
+				try
+				{
+					float value = s.empty() ? INITIAL_VALUE : std::stod(s);
+					slider.setValue((value - MIN_VALUE) / (MAX_VALUE - MIN_VALUE));
+					setStepTime(value);
+					return true;
+				}
+				catch (std::exception&)
+				{
+				}
+
+				return false;
+			});
+
+			slider.setCallback([=, &textBox](float value)
+			{
+				float k = MIN_VALUE + value * (MAX_VALUE - MIN_VALUE);
+				textBox.setValue(std::format("%g", k));
+				setStepTime(k);
+			});
+		}
+
+		// Interpolate
+		{
+			panel.add<nanogui::Label>("Interpolate: ", "sans-bold");
+			panel.add<nanogui::CheckBox>("", [=](bool state)
+			{
+				setInterpolate(state);
+			})
+			.withChecked(interpolate)
+			.withFontSize(16);
+		}
+
+		// Max Steps
+		{
+			const float MIN_VALUE = 1;
+			const float MAX_VALUE = 20;
+			const float INITIAL_VALUE = maxSteps;
+
+			panel.add<nanogui::Label>("Max Steps: ", "sans-bold");
+			auto& area = panel.add<Widget>().withLayout<nanogui::BoxLayout>(nanogui::Orientation::Horizontal, nanogui::Alignment::Maximum, 0, 16);
+			auto& textBox = area.add<nanogui::TextBox>(std::format("%g", INITIAL_VALUE));
+			textBox.setAlignment(nanogui::TextBox::Alignment::Right);
+			textBox.setEditable(true);
+			textBox.setFontSize(16);
+			textBox.setFixedWidth(100);
+			textBox.setDefaultValue("1");
+			textBox.setFormat("^[1-9][0-9]?$");
+
+			auto& slider = area.add<nanogui::Slider>();
+			slider.setValue((INITIAL_VALUE - MIN_VALUE) / (MAX_VALUE - MIN_VALUE));
+			slider.setFixedSize(Eigen::Vector2i(100, 16));
+
+			textBox.setCallback([=, &slider](const std::string& s)
+			{
+				try
+				{
+					int value = s.empty() ? 1 : std::stoi(s);
+					slider.setValue((value - MIN_VALUE) / (MAX_VALUE - MIN_VALUE));
+					setMaxSteps(value);
+					return true;
+				}
+				catch (std::exception&)
+				{
+				}
+
+				return false;
+			});
+
+			slider.setCallback([=, &textBox](float value)
+			{
+				int k = int(MIN_VALUE + value * (MAX_VALUE - MIN_VALUE) + 0.5f);
+				textBox.setValue(std::format("%d", k));
+				setMaxSteps(k);
+			});
+		}
+
+		// Overload
+		{
+			panel.add<nanogui::Label>("Overload: ", "sans-bold");
+			auto& combo = panel.add<nanogui::ComboBox>(std::vector<std::string>{ "Drop Time", "Slow Down" });
+			combo.setSelectedIndex(overload);
+			combo.setFontSize(16);
+			combo.setFixedSize(Eigen::Vector2i(100, 20));
+			combo.setCallback([=](int index)
+			{
+				setOverload(index);
+			});
+		}
+
+		// Throttle
+		{
+			panel.add<nanogui::Label>("Throttle Spawns: ", "sans-bold");
+			panel.add<nanogui::CheckBox>("", [=](bool state)
+			{
+				setThrottle(state);
+			})
+			.withChecked(throttle)
+			.withFontSize(16);
+		}
+
+		// Max FPS
+		{
+			const float MIN_VALUE = 0;
+			const float MAX_VALUE = 240;
+			const float INITIAL_VALUE = maxFPS;
+
+			panel.add<nanogui::Label>("Max FPS: ", "sans-bold");
+			auto& area = panel.add<Widget>().withLayout<nanogui::BoxLayout>(nanogui::Orientation::Horizontal, nanogui::Alignment::Maximum, 0, 16);
+			auto& textBox = area.add<nanogui::TextBox>(std::format("%g", INITIAL_VALUE));
+			textBox.setAlignment(nanogui::TextBox::Alignment::Right);
+			textBox.setEditable(true);
+			textBox.setFontSize(16);
+			textBox.setFixedWidth(100);
+			textBox.setDefaultValue("0");
+			textBox.setFormat("^0$|^[1-9][0-9]{0,2}$");
+
+			auto& slider = area.add<nanogui::Slider>();
+			slider.setValue((INITIAL_VALUE - MIN_VALUE) / (MAX_VALUE - MIN_VALUE));
+			slider.setFixedSize(Eigen::Vector2i(100, 16));
+
+			textBox.setCallback([=, &slider](const std::string& s)
+			{
+				try
+				{
+					int value = s.empty() ? 0 : std::stoi(s);
+					slider.setValue((value - MIN_VALUE) / (MAX_VALUE - MIN_VALUE));
+					setMaxFPS(value);
+					return true;
+				}
+				catch (std::exception&)
+				{
+				}
+
+				return false;
+			});
+
+			slider.setCallback([=, &textBox](float value)
+			{
+				int k = int(MIN_VALUE + value * (MAX_VALUE - MIN_VALUE) + 0.5f);
+				textBox.setValue(std::format("%d", k));
+				setMaxFPS(k);
+			});
+		}
+
+		// VSync
+		{
+			panel.add<nanogui::Label>("VSync: ", "sans-bold");
+			auto& combo = panel.add<nanogui::ComboBox>(std::vector<std::string>{ "Off", "On", "Adaptive" });
+			combo.setSelectedIndex(vsync);
+			combo.setFontSize(16);
+			combo.setFixedSize(Eigen::Vector2i(100, 20));
+			combo.setCallback([=](int index)
+			{
+				setVSync(index);
+			});
+		}
+
+		// Idle
+		{
+			panel.add<nanogui::Label>("Idle When Empty: ", "sans-bold");
+			panel.add<nanogui::CheckBox>("", [=](bool state)
+			{
+				setIdle(state);
+			})
+			.withChecked(idle)
+			.withFontSize(16);
+		}
 	}
 
 	performLayout(mNVGContext);
@@ -570,6 +986,20 @@ setFPS(int value)
 	textFPS->setValue(std::format("%d", value));
 }
 
+void
+MainScreen::
+setSimRate(float value)
+{
+	textSimRate->setValue(std::format("%.1f", value));
+}
+
+void
+MainScreen::
+setSteps(int run, int skipped, int throttled)
+{
+	textSteps->setValue(std::format("%d / %d / %d", run, skipped, throttled));
+}
+
 void
 MainScreen::
 setParticleCount(int value)
@@ -577,6 +1007,20 @@ setParticleCount(int value)
 	textParticleCount->setValue(std::format("%d", value));
 }
 
+void
+MainScreen::
+setUpdateTime(float value)
+{
+	textUpdateTime->setValue(std::format("%.3f", value));
+}
+
+void
+MainScreen::
+setAllocations(int value)
+{
+	textAllocations->setValue(std::format("%d", value));
+}
+
 bool 
 MainScreen::
 keyboardEvent(int key, int scancode, int action, int modifiers)
@@ -657,6 +1101,62 @@ float
 MainScreen::
 getGravity() { return gravity; }
 
+int
+MainScreen::
+getCollisions() { return collisions; }
+
+int
+MainScreen::
+getInteraction() { return interaction; }
+
+bool
+MainScreen::
+getParticleForces() { return particleForces; }
+
+float
+MainScreen::
+getOpeningAngle() { return openingAngle; }
+
+int
+MainScreen::
+getThreads() { return threads; }
+
+int
+MainScreen::
+getRenderer() { return renderer; }
+
+float
+MainScreen::
+getStepTime() { return stepTime; }
+
+bool
+MainScreen::
+getInterpolate() { return interpolate; }
+
+int
+MainScreen::
+getMaxSteps() { return maxSteps; }
+
+int
+MainScreen::
+getOverload() { return overload; }
+
+bool
+MainScreen::
+getThrottle() { return throttle; }
+
+int
+MainScreen::
+getMaxFPS() { return maxFPS; }
+
+int
+MainScreen::
+getVSync() { return vsync; }
+
+bool
+MainScreen::
+getIdle() { return idle; }
+
 void
 MainScreen::
 setEnabled(bool value)
@@ -775,5 +1275,128 @@ setGravity(float value)
 		gravityChanged(value);
 }
 
+void
+MainScreen::
+setCollisions(int value)
+{
+	collisions = value;
+	if (collisionsChanged)
+		collisionsChanged(value);
+}
+
+void
+MainScreen::
+setInteraction(int value)
+{
+	interaction = value;
+	if (interactionChanged)
+		interactionChanged(value);
+}
+
+void
+MainScreen::
+setParticleForces(bool value)
+{
+	particleForces = value;
+	if (particleForcesChanged)
+		particleForcesChanged(value);
+}
+
+void
+MainScreen::
+setOpeningAngle(float value)
+{
+	openingAngle = value;
+	if (openingAngleChanged)
+		openingAngleChanged(value);
+}
+
+void
+MainScreen::
+setThreads(int value)
+{
+	threads = value;
+	if (threadsChanged)
+		threadsChanged(value);
+}
 
+void
+MainScreen::
+setRenderer(int value)
+{
+	renderer = value;
+	if (rendererChanged)
+		rendererChanged(value);
+}
+
+void
+MainScreen::
+setStepTime(float value)
+{
+	stepTime = value;
+	if (stepTimeChanged)
+		stepTimeChanged(value);
+}
+
+void
+MainScreen::
+setInterpolate(bool value)
+{
+	interpolate = value;
+	if (interpolateChanged)
+		interpolateChanged(value);
+}
+
+void
+MainScreen::
+setMaxSteps(int value)
+{
+	maxSteps = value;
+	if (maxStepsChanged)
+		maxStepsChanged(value);
+}
 
+void
+MainScreen::
+setOverload(int value)
+{
+	overload = value;
+	if (overloadChanged)
+		overloadChanged(value);
+}
+
+void
+MainScreen::
+setThrottle(bool value)
+{
+	throttle = value;
+	if (throttleChanged)
+		throttleChanged(value);
+}
+
+void
+MainScreen::
+setMaxFPS(int value)
+{
+	maxFPS = value;
+	if (maxFPSChanged)
+		maxFPSChanged(value);
+}
+
+void
+MainScreen::
+setVSync(int value)
+{
+	vsync = value;
+	if (vsyncChanged)
+		vsyncChanged(value);
+}
+
+void
+MainScreen::
+setIdle(bool value)
+{
+	idle = value;
+	if (idleChanged)
+		idleChanged(value);
+}
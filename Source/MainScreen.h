@@ -9,7 +9,11 @@ class MainScreen :	public nanogui::Screen
 {
 	// Widgets
 	nanogui::TextBox* textFPS;
+	nanogui::TextBox* textSimRate;
+	nanogui::TextBox* textSteps;
 	nanogui::TextBox* textParticleCount;
+	nanogui::TextBox* textUpdateTime;
+	nanogui::TextBox* textAllocations;
 
 	// Settings
 	bool enabled;
@@ -25,6 +29,20 @@ class MainScreen :	public nanogui::Screen
 	float minSpeed;
 	float maxSpeed;
 	float gravity;
+	int collisions;
+	int interaction;
+	bool particleForces;
+	float openingAngle;
+	int threads;
+	int renderer;
+	float stepTime;
+	bool interpolate;
+	int maxSteps;
+	int overload;
+	bool throttle;
+	int maxFPS;
+	int vsync;
+	bool idle;
 
 public:
 	MainScreen(const std::string& title, SDL_Window* pwindow, int rwidth, int rheight);
@@ -37,7 +55,11 @@ public:
 	virtual void drawContents();
 
 	void setFPS(int value);
+	void setSimRate(float value);
+	void setSteps(int run, int skipped, int throttled);
 	void setParticleCount(int value);
+	void setUpdateTime(float value);
+	void setAllocations(int value);
 
 	std::function<void(bool)> enableChanged;
 	std::function<void(const nanogui::Color&)> colorChanged;
@@ -52,6 +74,20 @@ public:
 	std::function<void(float)> minSpeedChanged;
 	std::function<void(float)> maxSpeedChanged;
 	std::function<void(float)> gravityChanged;
+	std::function<void(int)> collisionsChanged;
+	std::function<void(int)> interactionChanged;
+	std::function<void(bool)> particleForcesChanged;
+	std::function<void(float)> openingAngleChanged;
+	std::function<void(int)> threadsChanged;
+	std::function<void(int)> rendererChanged;
+	std::function<void(float)> stepTimeChanged;
+	std::function<void(bool)> interpolateChanged;
+	std::function<void(int)> maxStepsChanged;
+	std::function<void(int)> overloadChanged;
+	std::function<void(bool)> throttleChanged;
+	std::function<void(int)> maxFPSChanged;
+	std::function<void(int)> vsyncChanged;
+	std::function<void(bool)> idleChanged;
 
 	bool getEnabled();
 	nanogui::Color getColor();
@@ -66,6 +102,20 @@ public:
 	float getMinSpeed();
 	float getMaxSpeed();
 	float getGravity();
+	int getCollisions();
+	int getInteraction();
+	bool getParticleForces();
+	float getOpeningAngle();
+	int getThreads();
+	int getRenderer();
+	float getStepTime();
+	bool getInterpolate();
+	int getMaxSteps();
+	int getOverload();
+	bool getThrottle();
+	int getMaxFPS();
+	int getVSync();
+	bool getIdle();
 
 	void setEnabled(bool value);
 	void setColor(const nanogui::Color& value);
@@ -80,6 +130,20 @@ public:
 	void setMinSpeed(float value);
 	void setMaxSpeed(float value);
 	void setGravity(float value);
+	void setCollisions(int value);
+	void setInteraction(int value);
+	void setParticleForces(bool value);
+	void setOpeningAngle(float value);
+	void setThreads(int value);
+	void setRenderer(int value);
+	void setStepTime(float value);
+	void setInterpolate(bool value);
+	void setMaxSteps(int value);
+	void setOverload(int value);
+	void setThrottle(bool value);
+	void setMaxFPS(int value);
+	void setVSync(int value);
+	void setIdle(bool value);
 };
 
 
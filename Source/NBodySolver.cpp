@@ -0,0 +1,355 @@
+#include "NBodySolver.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "SDL/SDL.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define NBODY_SOLVER_SSE2
+#include <emmintrin.h>
+#endif
+
+const float NBodySolver::SOFTENING = 4.0f;
+
+namespace
+{
+	float
+	millisecondsSince(Uint64 start)
+	{
+		return float(SDL_GetPerformanceCounter() - start) * 1000 / SDL_GetPerformanceFrequency();
+	}
+
+#if defined(NBODY_SOLVER_SSE2)
+	// Adds the field at (x, y) of four sources
+	inline void
+	accumulate(__m128 x, __m128 y, __m128 sourceX, __m128 sourceY, __m128 sourceMass, __m128 softening2, __m128& ax, __m128& ay)
+	{
+		__m128 dx = _mm_sub_ps(sourceX, x);
+		__m128 dy = _mm_sub_ps(sourceY, y);
+		__m128 inverse = _mm_div_ps(_mm_set1_ps(1.0f), _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), softening2));
+		__m128 strength = _mm_mul_ps(_mm_mul_ps(sourceMass, inverse), _mm_sqrt_ps(inverse));
+		ax = _mm_add_ps(ax, _mm_mul_ps(dx, strength));
+		ay = _mm_add_ps(ay, _mm_mul_ps(dy, strength));
+	}
+
+	float
+	sum(__m128 value)
+	{
+		float lanes[4];
+		_mm_storeu_ps(lanes, value);
+		return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	}
+#endif
+}
+
+NBodySolver::
+NBodySolver()
+: mode(Off),
+  method(BarnesHut),
+  particleSources(false),
+  theta(0.5f),
+  particleMass(20),
+  particleCount(0),
+  sourceCount(0)
+{
+	timings.build = 0;
+	timings.field = 0;
+}
+
+void
+NBodySolver::
+apply(ParticleBuffer& particles, const std::vector<Body*>& bodies, float deltaTime, ThreadPool* threadPool)
+{
+	if (!sumField(particles, bodies, threadPool))
+		return;
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	const int CHUNK_SIZE = ParticleBuffer::CHUNK_SIZE;
+	int slices = (particleCount + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	if (threadPool)
+		threadPool->run(slices, [this, &particles, deltaTime](int slice) { applySlice(particles, slice, deltaTime); });
+	else
+		for (int slice = 0; slice < slices; ++slice)
+			applySlice(particles, slice, deltaTime);
+	timings.field += millisecondsSince(start);
+}
+
+bool
+NBodySolver::
+sumField(const ParticleBuffer& particles, const std::vector<Body*>& bodies, ThreadPool* threadPool)
+{
+	timings.build = 0;
+	timings.field = 0;
+	if (mode == Off || particles.size() == 0)
+		return false;
+
+	// every source in flat arrays, particles in buffer order
+	Uint64 start = SDL_GetPerformanceCounter();
+	const int CHUNK_SIZE = ParticleBuffer::CHUNK_SIZE;
+	particleCount = particles.size();
+	sourceCount = particleCount + (int)bodies.size();
+	if ((int)xs.size() < sourceCount)
+	{
+		int capacity = std::max(sourceCount, particles.capacity() + (int)bodies.size());
+		xs.resize(capacity);
+		ys.resize(capacity);
+		masses.resize(capacity);
+		fieldX.resize(capacity);
+		fieldY.resize(capacity);
+	}
+
+	int slices = (particleCount + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	if (threadPool)
+		threadPool->run(slices, [this, &particles](int slice) { gatherSlice(particles, slice); });
+	else
+		for (int slice = 0; slice < slices; ++slice)
+			gatherSlice(particles, slice);
+
+	for (int i = 0; i < (int)bodies.size(); ++i)
+	{
+		xs[particleCount + i] = bodies[i]->position.x;
+		ys[particleCount + i] = bodies[i]->position.y;
+		masses[particleCount + i] = bodies[i]->getMass();
+	}
+
+	// a handful of bodies are summed directly, and so is everything when
+	// asked to
+	bool useTree = particleSources && method == BarnesHut;
+	if (useTree)
+		tree.build(xs.data(), ys.data(), masses.data(), sourceCount, threadPool);
+	timings.build = millisecondsSince(start);
+
+	start = SDL_GetPerformanceCounter();
+	int blocks = useTree ? ((int)tree.getLeaves().size() + LEAF_BLOCK_SIZE - 1) / LEAF_BLOCK_SIZE : (particleCount + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	if (useTree && (int)blockSources.size() < blocks)
+		blockSources.resize(blocks);
+	if (threadPool)
+		threadPool->run(blocks, [this, useTree](int block) { if (useTree) sumTree(block); else sumDirect(block); });
+	else
+		for (int block = 0; block < blocks; ++block)
+			if (useTree)
+				sumTree(block);
+			else
+				sumDirect(block);
+	timings.field = millisecondsSince(start);
+	return true;
+}
+
+void
+NBodySolver::
+gatherSlice(const ParticleBuffer& particles, int slice)
+{
+	const ParticleChunk& chunk = particles.getChunk(slice);
+	int begin = slice * ParticleBuffer::CHUNK_SIZE;
+	int size = std::min(ParticleBuffer::CHUNK_SIZE, particleCount - begin);
+	std::copy(chunk.x, chunk.x + size, xs.data() + begin);
+	std::copy(chunk.y, chunk.y + size, ys.data() + begin);
+	std::fill(masses.data() + begin, masses.data() + begin + size, particleMass);
+}
+
+void
+NBodySolver::
+sumTree(int block)
+{
+	// A leaf at a time: its points all feel the same list of sources, which
+	// is walked once for them. A point's own term is zero, and bodies are
+	// in the tree as sources only. The list is padded with massless sources
+	// to read four at a time, each point being four floats it transposes
+	// into a vector of x, of y and of masses.
+	const std::vector<QuadTree::Node>& nodes = tree.getNodes();
+	const std::vector<QuadTree::Point>& points = tree.getPoints();
+	const std::vector<int>& leaves = tree.getLeaves();
+	float softening2 = SOFTENING * SOFTENING;
+	std::vector<QuadTree::Point>& sources = blockSources[block];
+	int begin = block * LEAF_BLOCK_SIZE;
+	int end = std::min(begin + LEAF_BLOCK_SIZE, (int)leaves.size());
+	for (int leaf = begin; leaf < end; ++leaf)
+	{
+		tree.interactions(leaves[leaf], theta, sources);
+#if defined(NBODY_SOLVER_SSE2)
+		QuadTree::Point padding = { 0, 0, 0, -1 };
+		while (sources.size() % 4)
+			sources.push_back(padding);
+#endif
+		const QuadTree::Node& node = nodes[leaves[leaf]];
+		for (int i = node.first; i < node.first + node.count; ++i)
+		{
+			const QuadTree::Point& point = points[i];
+			if (point.index >= particleCount)
+				continue;
+
+			float ax = 0;
+			float ay = 0;
+#if defined(NBODY_SOLVER_SSE2)
+			const __m128 x4 = _mm_set1_ps(point.x);
+			const __m128 y4 = _mm_set1_ps(point.y);
+			const __m128 softening4 = _mm_set1_ps(softening2);
+			__m128 ax4 = _mm_setzero_ps();
+			__m128 ay4 = _mm_setzero_ps();
+			const float* source = reinterpret_cast<const float*>(sources.data());
+			for (size_t j = 0; j < sources.size(); j += 4, source += 16)
+			{
+				__m128 sourceX = _mm_loadu_ps(source);
+				__m128 sourceY = _mm_loadu_ps(source + 4);
+				__m128 sourceMass = _mm_loadu_ps(source + 8);
+				__m128 index = _mm_loadu_ps(source + 12);
+				_MM_TRANSPOSE4_PS(sourceX, sourceY, sourceMass, index);
+				accumulate(x4, y4, sourceX, sourceY, sourceMass, softening4, ax4, ay4);
+			}
+			ax = sum(ax4);
+			ay = sum(ay4);
+#else
+			for (std::vector<QuadTree::Point>::const_iterator source = sources.begin(); source != sources.end(); ++source)
+			{
+				float dx = source->x - point.x;
+				float dy = source->y - point.y;
+				float inverse = 1 / (dx * dx + dy * dy + softening2);
+				float strength = source->mass * inverse * std::sqrt(inverse);
+				ax += dx * strength;
+				ay += dy * strength;
+			}
+#endif
+			fieldX[point.index] = ax;
+			fieldY[point.index] = ay;
+		}
+	}
+}
+
+void
+NBodySolver::
+sumDirect(int block)
+{
+	// sources are every particle and body, or just the bodies
+	int firstSource = particleSources ? 0 : particleCount;
+	float softening2 = SOFTENING * SOFTENING;
+	int begin = block * BLOCK_SIZE;
+	int end = std::min(begin + BLOCK_SIZE, particleCount);
+	for (int i = begin; i < end; ++i)
+	{
+		float x = xs[i];
+		float y = ys[i];
+		float ax = 0;
+		float ay = 0;
+		int j = firstSource;
+#if defined(NBODY_SOLVER_SSE2)
+		const __m128 x4 = _mm_set1_ps(x);
+		const __m128 y4 = _mm_set1_ps(y);
+		const __m128 softening4 = _mm_set1_ps(softening2);
+		__m128 ax4 = _mm_setzero_ps();
+		__m128 ay4 = _mm_setzero_ps();
+		for (; j + 4 <= sourceCount; j += 4)
+			accumulate(x4, y4, _mm_loadu_ps(xs.data() + j), _mm_loadu_ps(ys.data() + j), _mm_loadu_ps(masses.data() + j), softening4, ax4, ay4);
+		ax = sum(ax4);
+		ay = sum(ay4);
+#endif
+		for (; j < sourceCount; ++j)
+		{
+			float dx = xs[j] - x;
+			float dy = ys[j] - y;
+			float inverse = 1 / (dx * dx + dy * dy + softening2);
+			// a particle's own term is zero
+			float strength = masses[j] * inverse * std::sqrt(inverse);
+			ax += dx * strength;
+			ay += dy * strength;
+		}
+		fieldX[i] = ax;
+		fieldY[i] = ay;
+	}
+}
+
+void
+NBodySolver::
+applySlice(ParticleBuffer& particles, int slice, float deltaTime)
+{
+	ParticleChunk& chunk = particles.getChunk(slice);
+	int begin = slice * ParticleBuffer::CHUNK_SIZE;
+	int size = std::min(ParticleBuffer::CHUNK_SIZE, particleCount - begin);
+	float scale = mode == Electrostatic ? -deltaTime : deltaTime;
+	const float* ax = fieldX.data() + begin;
+	const float* ay = fieldY.data() + begin;
+	for (int i = 0; i < size; ++i)
+	{
+		chunk.vx[i] += ax[i] * scale;
+		chunk.vy[i] += ay[i] * scale;
+	}
+}
+
+void
+NBodySolver::
+setMode(Mode value)
+{
+	mode = value;
+	if (mode == Off)
+		tree.clear();
+}
+
+NBodySolver::Mode
+NBodySolver::
+getMode()
+{
+	return mode;
+}
+
+void
+NBodySolver::
+setMethod(Method value)
+{
+	method = value;
+}
+
+NBodySolver::Method
+NBodySolver::
+getMethod()
+{
+	return method;
+}
+
+void
+NBodySolver::
+setParticleSources(bool value)
+{
+	particleSources = value;
+}
+
+bool
+NBodySolver::
+getParticleSources()
+{
+	return particleSources;
+}
+
+void
+NBodySolver::
+setOpeningAngle(float value)
+{
+	theta = std::max(value, 0.0f);
+}
+
+float
+NBodySolver::
+getOpeningAngle()
+{
+	return theta;
+}
+
+void
+NBodySolver::
+setParticleMass(float value)
+{
+	particleMass = std::max(value, 0.0f);
+}
+
+float
+NBodySolver::
+getParticleMass()
+{
+	return particleMass;
+}
+
+NBodySolver::Timings
+NBodySolver::
+getTimings()
+{
+	return timings;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <vector>
+
+#include "Body.h"
+#include "ParticleBuffer.h"
+#include "QuadTree.h"
+#include "ThreadPool.h"
+
+// Pulls or pushes the particles with the inverse square forces of the
+// bodies and, optionally, of every other particle. Masses are in px^3/s^2,
+// the acceleration they cause at a distance of one pixel. With particles as
+// sources the field is summed over a Barnes-Hut QuadTree rebuilt every step,
+// in O(n log n), or directly in O(n^2) for reference. Bodies exert forces
+// but are placed by the user, so nothing moves them.
+class NBodySolver
+{
+public:
+	enum Mode
+	{
+		Off,
+		// everything attracts everything
+		Gravity,
+		// like charges, everything repels everything
+		Electrostatic
+	};
+
+	enum Method
+	{
+		// nodes seen under less than the opening angle count as one point
+		BarnesHut,
+		// every source is summed for every particle
+		Direct
+	};
+
+	// Milliseconds spent in the last apply() building the tree and summing
+	// the field
+	struct Timings
+	{
+		float build;
+		float field;
+	};
+
+	// Keeps close encounters from flinging particles away, in pixels
+	static const float SOFTENING;
+
+	// Particles summed by one task, and tree leaves
+	static const int BLOCK_SIZE = 4096;
+	static const int LEAF_BLOCK_SIZE = 512;
+
+private:
+	QuadTree tree;
+	Mode mode;
+	Method method;
+	bool particleSources;
+	float theta;
+	float particleMass;
+	// every source, the particles first then the bodies, and the field at
+	// every particle
+	std::vector<float> xs;
+	std::vector<float> ys;
+	std::vector<float> masses;
+	std::vector<float> fieldX;
+	std::vector<float> fieldY;
+	// sources every block of leaves feels, kept from step to step
+	std::vector<std::vector<QuadTree::Point> > blockSources;
+	int particleCount;
+	int sourceCount;
+	Timings timings;
+
+	void gatherSlice(const ParticleBuffer& particles, int slice);
+	void sumTree(int block);
+	void sumDirect(int block);
+	void applySlice(ParticleBuffer& particles, int slice, float deltaTime);
+
+public:
+	NBodySolver();
+
+	// Accelerates every particle by the field at its position
+	void apply(ParticleBuffer& particles, const std::vector<Body*>& bodies, float deltaTime, ThreadPool* threadPool = nullptr);
+
+	// Only sums the field at every particle, leaving them as they are;
+	// false when it is off or there are no particles
+	bool sumField(const ParticleBuffer& particles, const std::vector<Body*>& bodies, ThreadPool* threadPool = nullptr);
+
+	// Field at every particle of the last apply() or sumField(), towards the
+	// sources
+	const std::vector<float>& getFieldX() { return fieldX; }
+	const std::vector<float>& getFieldY() { return fieldY; }
+
+	void setMode(Mode value);
+	Mode getMode();
+
+	void setMethod(Method value);
+	Method getMethod();
+
+	// Whether particles pull on each other, rather than only the bodies on them
+	void setParticleSources(bool value);
+	bool getParticleSources();
+
+	// Largest side over distance a node is summed as one point at; 0 is exact
+	void setOpeningAngle(float value);
+	float getOpeningAngle();
+
+	void setParticleMass(float value);
+	float getParticleMass();
+
+	Timings getTimings();
+};
@@ -0,0 +1,239 @@
+#include "ParticleBuffer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+	// Rounds an array of n elements of the given size up to the chunk alignment
+	size_t
+	alignedSize(int n, size_t elementSize)
+	{
+		size_t bytes = n * elementSize;
+		return (bytes + ParticleChunk::ALIGNMENT - 1) & ~size_t(ParticleChunk::ALIGNMENT - 1);
+	}
+
+	template <typename T>
+	T*
+	carve(char*& cursor, int n)
+	{
+		T* result = reinterpret_cast<T*>(cursor);
+		cursor += alignedSize(n, sizeof(T));
+		return result;
+	}
+
+	template <typename T>
+	void
+	shift(T* to, const T* from, int n)
+	{
+		if (n > 0 && to != from)
+			memmove(to, from, n * sizeof(T));
+	}
+}
+
+ParticleChunk::
+ParticleChunk()
+{
+	size_t bytes = 7 * alignedSize(SIZE, sizeof(float))
+				 + alignedSize(SIZE, sizeof(SDL_Color))
+				 + 2 * alignedSize(SIZE, sizeof(unsigned char))
+				 + alignedSize(SIZE, sizeof(unsigned short));
+
+	storage = new char[bytes + ALIGNMENT];
+	char* cursor = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(storage) + ALIGNMENT - 1) & ~uintptr_t(ALIGNMENT - 1));
+
+	x = carve<float>(cursor, SIZE);
+	y = carve<float>(cursor, SIZE);
+	vx = carve<float>(cursor, SIZE);
+	vy = carve<float>(cursor, SIZE);
+	age = carve<float>(cursor, SIZE);
+	lifetime = carve<float>(cursor, SIZE);
+	gravity = carve<float>(cursor, SIZE);
+	color = carve<SDL_Color>(cursor, SIZE);
+	fade = carve<unsigned char>(cursor, SIZE);
+	colorIndex = carve<unsigned char>(cursor, SIZE);
+	emitter = carve<unsigned short>(cursor, SIZE);
+}
+
+ParticleChunk::
+~ParticleChunk()
+{
+	delete[] storage;
+}
+
+void
+ParticleChunk::
+move(int from, int to)
+{
+	x[to] = x[from];
+	y[to] = y[from];
+	vx[to] = vx[from];
+	vy[to] = vy[from];
+	age[to] = age[from];
+	lifetime[to] = lifetime[from];
+	gravity[to] = gravity[from];
+	fade[to] = fade[from];
+	color[to] = color[from];
+	colorIndex[to] = colorIndex[from];
+	emitter[to] = emitter[from];
+}
+
+bool
+ParticleChunk::
+isDead(int index) const
+{
+	return (age[index] >= lifetime[index]) || !isInside(index, -16777216, -16777216, 16777216, 16777216);
+}
+
+bool
+ParticleChunk::
+isInside(int index, int left, int top, int width, int height) const
+{
+	return x[index] >= left && x[index] <= width && y[index] >= top && y[index] <= height;
+}
+
+
+ParticleBuffer::
+ParticleBuffer(int capacity)
+: count(0),
+  maxCount(0),
+  allocations(0)
+{
+	reserve(capacity);
+}
+
+ParticleBuffer::
+~ParticleBuffer()
+{
+	for (std::vector<ParticleChunk*>::iterator it = chunks.begin(); it != chunks.end(); ++it)
+		delete *it;
+}
+
+int
+ParticleBuffer::
+size() const
+{
+	return count;
+}
+
+int
+ParticleBuffer::
+capacity() const
+{
+	return maxCount;
+}
+
+void
+ParticleBuffer::
+reserve(int capacity)
+{
+	maxCount = std::max(capacity, 0);
+
+	// keep the oldest particles if the buffer shrinks
+	count = std::min(count, maxCount);
+
+	size_t needed = (maxCount + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	while (chunks.size() > needed)
+	{
+		delete chunks.back();
+		chunks.pop_back();
+	}
+
+	if (chunks.capacity() < needed)
+	{
+		chunks.reserve(needed);
+		allocations++;
+	}
+
+	while (chunks.size() < needed)
+	{
+		chunks.push_back(new ParticleChunk());
+		allocations++;
+	}
+}
+
+int
+ParticleBuffer::
+getChunkCount() const
+{
+	return chunks.size();
+}
+
+ParticleChunk&
+ParticleBuffer::
+getChunk(int index)
+{
+	return *chunks[index];
+}
+
+const ParticleChunk&
+ParticleBuffer::
+getChunk(int index) const
+{
+	return *chunks[index];
+}
+
+// Grows the buffer by up to count uninitialized particles, which the caller
+// fills in directly. Returns the index of the first new particle.
+int
+ParticleBuffer::
+append(int count)
+{
+	int first = this->count;
+	this->count = std::min(this->count + std::max(count, 0), maxCount);
+	return first;
+}
+
+// Moves count particles from one index to a lower or equal one, possibly
+// across chunks.
+void
+ParticleBuffer::
+move(int from, int to, int count)
+{
+	while (count > 0 && from != to)
+	{
+		int fromOffset = from % CHUNK_SIZE;
+		int toOffset = to % CHUNK_SIZE;
+		int n = std::min(count, std::min(CHUNK_SIZE - fromOffset, CHUNK_SIZE - toOffset));
+
+		const ParticleChunk& source = *chunks[from / CHUNK_SIZE];
+		ParticleChunk& target = *chunks[to / CHUNK_SIZE];
+		shift(target.x + toOffset, source.x + fromOffset, n);
+		shift(target.y + toOffset, source.y + fromOffset, n);
+		shift(target.vx + toOffset, source.vx + fromOffset, n);
+		shift(target.vy + toOffset, source.vy + fromOffset, n);
+		shift(target.age + toOffset, source.age + fromOffset, n);
+		shift(target.lifetime + toOffset, source.lifetime + fromOffset, n);
+		shift(target.gravity + toOffset, source.gravity + fromOffset, n);
+		shift(target.color + toOffset, source.color + fromOffset, n);
+		shift(target.fade + toOffset, source.fade + fromOffset, n);
+		shift(target.colorIndex + toOffset, source.colorIndex + fromOffset, n);
+		shift(target.emitter + toOffset, source.emitter + fromOffset, n);
+
+		from += n;
+		to += n;
+		count -= n;
+	}
+}
+
+void
+ParticleBuffer::
+resize(int count)
+{
+	this->count = std::min(std::max(count, 0), maxCount);
+}
+
+void
+ParticleBuffer::
+clear()
+{
+	count = 0;
+}
+
+int
+ParticleBuffer::
+getAllocationCount() const
+{
+	return allocations;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vector>
+
+#include "SDL/SDL.h"
+
+// A fixed-size block of particles stored as separate contiguous arrays, so
+// that update and render passes stream through memory linearly instead of
+// chasing one pointer per particle. Indices are local to the chunk.
+class ParticleChunk
+{
+public:
+	// Number of particles per chunk
+	static const int SIZE = 16384;
+
+	// Alignment, in bytes, of every attribute array.
+	static const int ALIGNMENT = 32;
+
+	float* x;
+	float* y;
+	float* vx;
+	float* vy;
+	float* age;
+	float* lifetime;
+	float* gravity;
+	SDL_Color* color;
+	unsigned char* fade;
+	// slot of the color in the particle system's palette, for packed vertices
+	unsigned char* colorIndex;
+	// id of the emitter that spawned the particle
+	unsigned short* emitter;
+
+	ParticleChunk();
+	~ParticleChunk();
+
+	void move(int from, int to);
+
+	bool isDead(int index) const;
+	bool isInside(int index, int left, int top, int width, int height) const;
+
+private:
+	ParticleChunk(const ParticleChunk&);
+	ParticleChunk& operator=(const ParticleChunk&);
+
+	char* storage;
+};
+
+// Particle storage of a particle system, made of ParticleChunks. Growing the buffer
+// only allocates the missing chunks and never copies the existing ones, so
+// it can hold millions of particles. Adding and removing particles
+// never touches the heap; only reserve() allocates.
+class ParticleBuffer
+{
+public:
+	static const int CHUNK_SIZE = ParticleChunk::SIZE;
+
+	ParticleBuffer(int capacity = 0);
+	~ParticleBuffer();
+
+	int size() const;
+	int capacity() const;
+
+	void reserve(int capacity);
+
+	int getChunkCount() const;
+	ParticleChunk& getChunk(int index);
+	const ParticleChunk& getChunk(int index) const;
+
+	int append(int count);
+	void move(int from, int to, int count);
+	void resize(int count);
+	void clear();
+
+	int getAllocationCount() const;
+
+private:
+	ParticleBuffer(const ParticleBuffer&);
+	ParticleBuffer& operator=(const ParticleBuffer&);
+
+	std::vector<ParticleChunk*> chunks;
+	int count;
+	int maxCount;
+	int allocations;
+};
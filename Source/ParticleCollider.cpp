@@ -0,0 +1,303 @@
+#include "ParticleCollider.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "SDL/SDL.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define PARTICLE_COLLIDER_SSE2
+#include <emmintrin.h>
+#endif
+
+const float ParticleCollider::RELAXATION = 1.5f;
+
+namespace
+{
+	float
+	millisecondsSince(Uint64 start)
+	{
+		return float(SDL_GetPerformanceCounter() - start) * 1000 / SDL_GetPerformanceFrequency();
+	}
+}
+
+ParticleCollider::
+ParticleCollider(int width, int height)
+: grid(4, width, height),
+  iterations(0),
+  bands(1)
+{
+	grid.setIncludeOutside(false);
+	timings.broadphase = 0;
+	timings.narrowphase = 0;
+	timings.writeBack = 0;
+	timings.contacts = 0;
+}
+
+void
+ParticleCollider::
+setBounds(int width, int height)
+{
+	grid.setBounds(width, height);
+}
+
+void
+ParticleCollider::
+setIterations(int value)
+{
+	iterations = std::max(value, 0);
+}
+
+int
+ParticleCollider::
+getIterations()
+{
+	return iterations;
+}
+
+ParticleCollider::Timings
+ParticleCollider::
+getTimings()
+{
+	return timings;
+}
+
+void
+ParticleCollider::
+resolve(ParticleBuffer& particles, const std::vector<float>& emitterRadii, float deltaTime, ThreadPool* threadPool)
+{
+	timings.contacts = 0;
+	if (iterations == 0 || particles.size() == 0)
+	{
+		timings.broadphase = timings.narrowphase = timings.writeBack = 0;
+		return;
+	}
+
+	// cells as wide as the largest particle, so overlapping ones are never
+	// more than a cell apart
+	Uint64 start = SDL_GetPerformanceCounter();
+	float maxRadius = 0;
+	for (std::vector<float>::const_iterator it = emitterRadii.begin(); it != emitterRadii.end(); ++it)
+		maxRadius = std::max(maxRadius, *it);
+	float cellSize = std::max(2 * maxRadius, 1.0f);
+	if (cellSize != grid.getCellSize())
+		grid.setCellSize(cellSize);
+
+	grid.build(particles, threadPool);
+
+	// padded so candidates can be read four at a time past the last one
+	if ((int)xs.size() < particles.size() + 3)
+	{
+		xs.resize(particles.capacity() + 3);
+		ys.resize(particles.capacity() + 3);
+		nextXs.resize(particles.capacity() + 3);
+		nextYs.resize(particles.capacity() + 3);
+		radii.resize(particles.capacity() + 3);
+	}
+
+	const int CHUNK_SIZE = ParticleBuffer::CHUNK_SIZE;
+	int slices = (particles.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	if (threadPool)
+		threadPool->run(slices, [this, &particles, &emitterRadii](int slice) { gatherSlice(particles, emitterRadii, slice); });
+	else
+		for (int slice = 0; slice < slices; ++slice)
+			gatherSlice(particles, emitterRadii, slice);
+	timings.broadphase = millisecondsSince(start);
+
+	// a few bands per thread, so uneven ones even out
+	start = SDL_GetPerformanceCounter();
+	bands = std::min(grid.getRows(), threadPool ? threadPool->getThreadCount() * 4 : 1);
+	bandContacts.assign(bands, 0);
+	for (int pass = 0; pass < iterations; ++pass)
+	{
+		if (threadPool)
+			threadPool->run(bands, [this](int band) { solveBand(band); });
+		else
+			for (int band = 0; band < bands; ++band)
+				solveBand(band);
+
+		xs.swap(nextXs);
+		ys.swap(nextYs);
+		if (pass == 0)
+			for (int band = 0; band < bands; ++band)
+				timings.contacts += bandContacts[band];
+	}
+	// every pair was seen from both sides
+	timings.contacts /= 2;
+	timings.narrowphase = millisecondsSince(start);
+
+	start = SDL_GetPerformanceCounter();
+	if (threadPool)
+		threadPool->run(slices, [this, &particles, deltaTime](int slice) { writeBackSlice(particles, slice, deltaTime); });
+	else
+		for (int slice = 0; slice < slices; ++slice)
+			writeBackSlice(particles, slice, deltaTime);
+	timings.writeBack = millisecondsSince(start);
+}
+
+void
+ParticleCollider::
+gatherSlice(const ParticleBuffer& particles, const std::vector<float>& emitterRadii, int slice)
+{
+	const ParticleChunk& chunk = particles.getChunk(slice);
+	int begin = slice * ParticleBuffer::CHUNK_SIZE;
+	int size = std::min(ParticleBuffer::CHUNK_SIZE, particles.size() - begin);
+	int filed = grid.size();
+	for (int i = 0; i < size; ++i)
+	{
+		int entry = grid.getEntry(begin + i);
+		if (entry >= filed)
+			continue;
+
+		xs[entry] = chunk.x[i];
+		ys[entry] = chunk.y[i];
+		radii[entry] = emitterRadii[chunk.emitter[i]];
+	}
+}
+
+void
+ParticleCollider::
+solveBand(int band)
+{
+	// Every particle sums the corrections its overlaps call for and only
+	// writes its own next position, so bands never write the same entry.
+	// Coincident particles are split along x, the lower entry to the left.
+	// A third of the candidates overlap in a pile, too many to branch on, so
+	// four are checked at a time and the ones that don't overlap, or are past
+	// the end of the cells, are masked.
+	int columns = grid.getColumns();
+	int rows = grid.getRows();
+	int firstRow = band * rows / bands;
+	int lastRow = (band + 1) * rows / bands;
+	int contacts = 0;
+#if defined(PARTICLE_COLLIDER_SSE2)
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128i lanes = _mm_set_epi32(3, 2, 1, 0);
+#endif
+	for (int row = firstRow; row < lastRow; ++row)
+	{
+		int top = std::max(row - 1, 0);
+		int bottom = std::min(row + 1, rows - 1);
+		for (int column = 0; column < columns; ++column)
+		{
+			int cell = row * columns + column;
+			int left = std::max(column - 1, 0);
+			int right = std::min(column + 1, columns - 1);
+			for (int i = grid.getCellBegin(cell); i < grid.getCellEnd(cell); ++i)
+			{
+				float x = xs[i];
+				float y = ys[i];
+				float radius = radii[i];
+				float correctionX = 0;
+				float correctionY = 0;
+				int overlaps = 0;
+#if defined(PARTICLE_COLLIDER_SSE2)
+				const __m128 x4 = _mm_set1_ps(x);
+				const __m128 y4 = _mm_set1_ps(y);
+				const __m128 radius4 = _mm_set1_ps(radius);
+				const __m128i i4 = _mm_set1_epi32(i);
+				__m128 correctionX4 = zero;
+				__m128 correctionY4 = zero;
+#endif
+				for (int neighborRow = top; neighborRow <= bottom; ++neighborRow)
+				{
+					// the neighboring cells of a row are contiguous
+					int j = grid.getCellBegin(neighborRow * columns + left);
+					int end = grid.getCellEnd(neighborRow * columns + right);
+#if defined(PARTICLE_COLLIDER_SSE2)
+					const __m128i end4 = _mm_set1_epi32(end);
+					for (; j < end; j += 4)
+					{
+						__m128i index = _mm_add_epi32(_mm_set1_epi32(j), lanes);
+						__m128 dx = _mm_sub_ps(x4, _mm_loadu_ps(xs.data() + j));
+						__m128 dy = _mm_sub_ps(y4, _mm_loadu_ps(ys.data() + j));
+						__m128 distance = _mm_add_ps(radius4, _mm_loadu_ps(radii.data() + j));
+						__m128 distance2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+						__m128 candidate = _mm_castsi128_ps(_mm_andnot_si128(_mm_cmpeq_epi32(index, i4), _mm_cmplt_epi32(index, end4)));
+						__m128 overlapping = _mm_and_ps(candidate, _mm_cmplt_ps(distance2, _mm_mul_ps(distance, distance)));
+						__m128 apart = _mm_and_ps(overlapping, _mm_cmpgt_ps(distance2, zero));
+
+						// divides by one in the lanes that are masked out
+						__m128 length = _mm_sqrt_ps(distance2);
+						__m128 divisor = _mm_or_ps(_mm_and_ps(apart, length), _mm_andnot_ps(apart, one));
+						__m128 push = _mm_and_ps(apart, _mm_div_ps(_mm_mul_ps(half, _mm_sub_ps(distance, length)), divisor));
+						correctionX4 = _mm_add_ps(correctionX4, _mm_mul_ps(dx, push));
+						correctionY4 = _mm_add_ps(correctionY4, _mm_mul_ps(dy, push));
+
+						int mask = _mm_movemask_ps(overlapping);
+						overlaps += (mask & 1) + (mask >> 1 & 1) + (mask >> 2 & 1) + (mask >> 3);
+
+						int coincident = mask & ~_mm_movemask_ps(apart);
+						for (int lane = 0; coincident; ++lane, coincident >>= 1)
+							if (coincident & 1)
+								correctionX += i < j + lane ? -0.5f * (radius + radii[j + lane]) : 0.5f * (radius + radii[j + lane]);
+					}
+#else
+					for (; j < end; ++j)
+					{
+						float dx = x - xs[j];
+						float dy = y - ys[j];
+						float distance = radius + radii[j];
+						float distance2 = dx * dx + dy * dy;
+						if (distance2 >= distance * distance || j == i)
+							continue;
+
+						if (distance2 > 0)
+						{
+							float length = std::sqrt(distance2);
+							float push = 0.5f * (distance - length) / length;
+							correctionX += dx * push;
+							correctionY += dy * push;
+						}
+						else
+							correctionX += i < j ? -0.5f * distance : 0.5f * distance;
+						++overlaps;
+					}
+#endif
+				}
+
+#if defined(PARTICLE_COLLIDER_SSE2)
+				float sumX[4];
+				float sumY[4];
+				_mm_storeu_ps(sumX, correctionX4);
+				_mm_storeu_ps(sumY, correctionY4);
+				correctionX += sumX[0] + sumX[1] + sumX[2] + sumX[3];
+				correctionY += sumY[0] + sumY[1] + sumY[2] + sumY[3];
+#endif
+
+				float scale = overlaps > 1 ? std::min(RELAXATION / overlaps, 1.0f) : 1.0f;
+				nextXs[i] = x + correctionX * scale;
+				nextYs[i] = y + correctionY * scale;
+				contacts += overlaps;
+			}
+		}
+	}
+
+	bandContacts[band] = contacts;
+}
+
+void
+ParticleCollider::
+writeBackSlice(ParticleBuffer& particles, int slice, float deltaTime)
+{
+	ParticleChunk& chunk = particles.getChunk(slice);
+	int begin = slice * ParticleBuffer::CHUNK_SIZE;
+	int size = std::min(ParticleBuffer::CHUNK_SIZE, particles.size() - begin);
+	int filed = grid.size();
+	float inverseDeltaTime = deltaTime > 0 ? 1 / deltaTime : 0;
+	for (int i = 0; i < size; ++i)
+	{
+		int entry = grid.getEntry(begin + i);
+		if (entry >= filed)
+			continue;
+
+		float dx = xs[entry] - chunk.x[i];
+		float dy = ys[entry] - chunk.y[i];
+		chunk.x[i] += dx;
+		chunk.y[i] += dy;
+		chunk.vx[i] += dx * inverseDeltaTime;
+		chunk.vy[i] += dy * inverseDeltaTime;
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+
+#include "ParticleBuffer.h"
+#include "SpatialGrid.h"
+#include "ThreadPool.h"
+
+// Keeps particles from passing through each other, treating every one as a
+// disc of its emitter's radius. A SpatialGrid with cells as wide as the
+// largest particle is the broadphase, so every particle only looks at the
+// 3x3 cells around its own. The narrowphase runs bands of grid rows in
+// parallel and pushes overlapping pairs apart by their overlap, averaged
+// over a particle's contacts, a configurable number of times. Every pass
+// reads the positions of the previous one and writes its own, so the result
+// doesn't depend on the number of threads. What the particles were moved by
+// is finally added to their velocity, so they come to rest against each
+// other rather than bounce. Particles outside the bounds don't collide.
+class ParticleCollider
+{
+public:
+	// Milliseconds spent in every phase of the last resolve(), and the
+	// number of overlapping pairs its first pass found
+	struct Timings
+	{
+		float broadphase;
+		float narrowphase;
+		float writeBack;
+		int contacts;
+	};
+
+	// How far past a full correction a particle with several contacts is
+	// pushed, to make up for averaging them
+	static const float RELAXATION;
+
+private:
+	SpatialGrid grid;
+	int iterations;
+	int bands;
+	// per grid entry: the position being solved, the next one and the radius
+	std::vector<float> xs;
+	std::vector<float> ys;
+	std::vector<float> nextXs;
+	std::vector<float> nextYs;
+	std::vector<float> radii;
+	std::vector<int> bandContacts;
+	Timings timings;
+
+	void gatherSlice(const ParticleBuffer& particles, const std::vector<float>& emitterRadii, int slice);
+	void solveBand(int band);
+	void writeBackSlice(ParticleBuffer& particles, int slice, float deltaTime);
+
+public:
+	ParticleCollider(int width = 0, int height = 0);
+
+	void setBounds(int width, int height);
+
+	// Separation passes every resolve() runs; 0 turns collisions off
+	void setIterations(int value);
+	int getIterations();
+
+	// Moves the overlapping particles apart, given the radius of the
+	// particles of every emitter
+	void resolve(ParticleBuffer& particles, const std::vector<float>& emitterRadii, float deltaTime, ThreadPool* threadPool = nullptr);
+
+	Timings getTimings();
+};
@@ -0,0 +1,365 @@
+#include "ParticleRenderer.h"
+
+#include <cstddef>
+#include <cstdio>
+
+#include "GLFunctions.h"
+
+namespace
+{
+	// Generic attribute slots of the sprite programs
+	const GLuint POSITION_ATTRIBUTE = 0;
+	const GLuint STATE_ATTRIBUTE = 1;
+
+	// GLSL 1.10 (GL 2.0). Age is the fraction of the lifetime, so the fade
+	// age / (lifetime - age) of the fixed-function paths is t / (1 - t).
+	const char* SPRITE_VERTEX_SHADER =
+		"#version 110\n"
+		"attribute vec2 position;\n"
+		"attribute float age;\n"
+		"uniform vec4 color;\n"
+		"uniform float fade;\n"
+		"uniform float pointSize;\n"
+		"varying vec4 fragmentColor;\n"
+		"void main()\n"
+		"{\n"
+		"	float t = clamp(age / max(1.0 - age, 1e-6), 0.0, 1.0);\n"
+		"	fragmentColor = vec4(color.rgb, color.a * (1.0 - fade * t));\n"
+		"	gl_Position = gl_ModelViewProjectionMatrix * vec4(position, 0.0, 1.0);\n"
+		"	gl_PointSize = pointSize;\n"
+		"	gl_TexCoord[0] = vec4(0.0);\n"
+		"}\n";
+
+	// Packed particles: position normalized to the viewport, then the age
+	// byte, the palette slot and the fade flag as plain numbers. The palette
+	// has PackedParticle::PALETTE_SIZE entries.
+	const char* PACKED_VERTEX_SHADER =
+		"#version 110\n"
+		"attribute vec2 position;\n"
+		"attribute vec3 state;\n"
+		"uniform vec4 palette[64];\n"
+		"uniform vec2 viewport;\n"
+		"uniform float pointSize;\n"
+		"varying vec4 fragmentColor;\n"
+		"void main()\n"
+		"{\n"
+		"	float age = state.x / 255.0;\n"
+		"	float t = clamp(age / max(1.0 - age, 1e-6), 0.0, 1.0);\n"
+		"	vec4 color = palette[int(state.y)];\n"
+		"	fragmentColor = vec4(color.rgb, color.a * (1.0 - state.z * t));\n"
+		"	gl_Position = gl_ModelViewProjectionMatrix * vec4(position * viewport, 0.0, 1.0);\n"
+		"	gl_PointSize = pointSize;\n"
+		"	gl_TexCoord[0] = vec4(0.0);\n"
+		"}\n";
+
+	// Round points: coverage falls off over the last pixel of the radius.
+	// GLSL 1.10 has no gl_PointCoord, the sprite coordinates replace the
+	// first texture coordinate instead.
+	const char* FRAGMENT_SHADER =
+		"#version 110\n"
+		"uniform float pointSize;\n"
+		"varying vec4 fragmentColor;\n"
+		"void main()\n"
+		"{\n"
+		"	float radius = 0.5 * pointSize;\n"
+		"	float offset = length(gl_TexCoord[0].xy - vec2(0.5)) * pointSize;\n"
+		"	float coverage = clamp(radius - offset + 0.5, 0.0, 1.0);\n"
+		"	if (coverage <= 0.0)\n"
+		"		discard;\n"
+		"	gl_FragColor = vec4(fragmentColor.rgb, fragmentColor.a * coverage);\n"
+		"}\n";
+
+	GLuint
+	compile(GLenum type, const char* source)
+	{
+		GLuint shader = GLFunctions::glCreateShader(type);
+		GLFunctions::glShaderSource(shader, 1, &source, nullptr);
+		GLFunctions::glCompileShader(shader);
+
+		GLint status = GL_FALSE;
+		GLFunctions::glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+		if (status != GL_TRUE)
+		{
+			char log[1024] = "";
+			GLFunctions::glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+			fprintf(stderr, "WARNING: Particle shader failed to compile: %s\n", log);
+			GLFunctions::glDeleteShader(shader);
+			return 0;
+		}
+
+		return shader;
+	}
+}
+
+ParticleRenderer::
+ParticleRenderer(Mode mode)
+: mode(mode),
+  buffer(0),
+  bufferSize(0)
+{
+	Program none = { 0, -1, -1, -1, -1, -1 };
+	spriteProgram = none;
+	packedProgram = none;
+
+	if (GLFunctions::hasBufferObjects())
+		GLFunctions::glGenBuffers(1, &buffer);
+
+	if (GLFunctions::hasShaders())
+	{
+		createProgram(spriteProgram, SPRITE_VERTEX_SHADER, "age");
+		createProgram(packedProgram, PACKED_VERTEX_SHADER, "state");
+	}
+
+	setMode(mode);
+}
+
+ParticleRenderer::
+~ParticleRenderer()
+{
+	if (buffer)
+		GLFunctions::glDeleteBuffers(1, &buffer);
+
+	if (spriteProgram.id)
+		GLFunctions::glDeleteProgram(spriteProgram.id);
+	if (packedProgram.id)
+		GLFunctions::glDeleteProgram(packedProgram.id);
+}
+
+bool
+ParticleRenderer::
+createProgram(Program& program, const char* vertexSource, const char* attribute)
+{
+	GLuint vertexShader = compile(GL_VERTEX_SHADER, vertexSource);
+	GLuint fragmentShader = compile(GL_FRAGMENT_SHADER, FRAGMENT_SHADER);
+	GLuint id = 0;
+	if (vertexShader && fragmentShader)
+	{
+		id = GLFunctions::glCreateProgram();
+		GLFunctions::glAttachShader(id, vertexShader);
+		GLFunctions::glAttachShader(id, fragmentShader);
+		GLFunctions::glBindAttribLocation(id, POSITION_ATTRIBUTE, "position");
+		GLFunctions::glBindAttribLocation(id, STATE_ATTRIBUTE, attribute);
+		GLFunctions::glLinkProgram(id);
+
+		GLint status = GL_FALSE;
+		GLFunctions::glGetProgramiv(id, GL_LINK_STATUS, &status);
+		if (status != GL_TRUE)
+		{
+			char log[1024] = "";
+			GLFunctions::glGetProgramInfoLog(id, sizeof(log), nullptr, log);
+			fprintf(stderr, "WARNING: Particle shader failed to link: %s\n", log);
+			GLFunctions::glDeleteProgram(id);
+			id = 0;
+		}
+	}
+
+	// the program keeps what it needs once linked
+	if (vertexShader)
+		GLFunctions::glDeleteShader(vertexShader);
+	if (fragmentShader)
+		GLFunctions::glDeleteShader(fragmentShader);
+
+	if (!id)
+		return false;
+
+	program.id = id;
+	program.color = GLFunctions::glGetUniformLocation(id, "color");
+	program.fade = GLFunctions::glGetUniformLocation(id, "fade");
+	program.pointSize = GLFunctions::glGetUniformLocation(id, "pointSize");
+	program.palette = GLFunctions::glGetUniformLocation(id, "palette");
+	program.viewport = GLFunctions::glGetUniformLocation(id, "viewport");
+	return true;
+}
+
+void
+ParticleRenderer::
+setMode(Mode value)
+{
+	// fall back to the best path the context supports
+	if (value == PackedShader && (!packedProgram.id || !buffer))
+		value = Shader;
+	if (value == Shader && (!spriteProgram.id || !buffer))
+		value = VertexBuffer;
+	if (value == VertexBuffer && !buffer)
+		value = VertexArray;
+
+	mode = value;
+}
+
+ParticleRenderer::Mode
+ParticleRenderer::
+getMode()
+{
+	return mode;
+}
+
+VertexFormat
+ParticleRenderer::
+getVertexFormat()
+{
+	switch (mode)
+	{
+	case Shader:
+		return SpriteVertex;
+
+	case PackedShader:
+		return PackedVertex;
+
+	default:
+		return ColoredVertex;
+	}
+}
+
+void
+ParticleRenderer::
+draw(const ParticleVertex* vertices, int count, float pointSize)
+{
+	glPointSize(pointSize);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	if (count <= 0)
+		return;
+
+	switch (mode)
+	{
+	case Immediate:
+		drawImmediate(vertices, count);
+		break;
+
+	case VertexArray:
+		drawArrays(vertices, count);
+		break;
+
+	default:
+		drawArrays(static_cast<const ParticleVertex*>(upload(vertices, count * sizeof(ParticleVertex))), count);
+		GLFunctions::glBindBuffer(GL_ARRAY_BUFFER, 0);
+		break;
+	}
+}
+
+void
+ParticleRenderer::
+draw(const ParticleSprite* vertices, int count, float pointSize, const SDL_Color& color, bool fade)
+{
+	// sprites can only be drawn by the shader
+	if (count <= 0 || !spriteProgram.id)
+		return;
+
+	beginSprites(spriteProgram, pointSize);
+	GLFunctions::glUniform4f(spriteProgram.color, color.r / 255.f, color.g / 255.f, color.b / 255.f, color.a / 255.f);
+	GLFunctions::glUniform1f(spriteProgram.fade, fade ? 1.f : 0.f);
+
+	const char* base = static_cast<const char*>(upload(vertices, count * sizeof(ParticleSprite)));
+	GLFunctions::glVertexAttribPointer(POSITION_ATTRIBUTE, 2, GL_FLOAT, GL_FALSE, sizeof(ParticleSprite), base + offsetof(ParticleSprite, x));
+	GLFunctions::glVertexAttribPointer(STATE_ATTRIBUTE, 1, GL_FLOAT, GL_FALSE, sizeof(ParticleSprite), base + offsetof(ParticleSprite, age));
+
+	glDrawArrays(GL_POINTS, 0, count);
+	endSprites();
+}
+
+void
+ParticleRenderer::
+draw(const PackedParticle* vertices, int count, float pointSize, const SDL_Color* palette, int paletteSize, int width, int height)
+{
+	if (count <= 0 || !packedProgram.id)
+		return;
+
+	float colors[PackedParticle::PALETTE_SIZE][4];
+	paletteSize = paletteSize < PackedParticle::PALETTE_SIZE ? paletteSize : PackedParticle::PALETTE_SIZE;
+	for (int i = 0; i < paletteSize; ++i)
+	{
+		colors[i][0] = palette[i].r / 255.f;
+		colors[i][1] = palette[i].g / 255.f;
+		colors[i][2] = palette[i].b / 255.f;
+		colors[i][3] = palette[i].a / 255.f;
+	}
+
+	beginSprites(packedProgram, pointSize);
+	GLFunctions::glUniform4fv(packedProgram.palette, paletteSize, colors[0]);
+	GLFunctions::glUniform2f(packedProgram.viewport, (float)width, (float)height);
+
+	const char* base = static_cast<const char*>(upload(vertices, count * sizeof(PackedParticle)));
+	GLFunctions::glVertexAttribPointer(POSITION_ATTRIBUTE, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedParticle), base + offsetof(PackedParticle, x));
+	GLFunctions::glVertexAttribPointer(STATE_ATTRIBUTE, 3, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(PackedParticle), base + offsetof(PackedParticle, age));
+
+	glDrawArrays(GL_POINTS, 0, count);
+	endSprites();
+}
+
+void
+ParticleRenderer::
+beginSprites(const Program& program, float pointSize)
+{
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
+	glEnable(GL_POINT_SPRITE);
+	glTexEnvi(GL_POINT_SPRITE, GL_COORD_REPLACE, GL_TRUE);
+
+	GLFunctions::glUseProgram(program.id);
+	GLFunctions::glUniform1f(program.pointSize, pointSize);
+	GLFunctions::glEnableVertexAttribArray(POSITION_ATTRIBUTE);
+	GLFunctions::glEnableVertexAttribArray(STATE_ATTRIBUTE);
+}
+
+void
+ParticleRenderer::
+endSprites()
+{
+	GLFunctions::glDisableVertexAttribArray(STATE_ATTRIBUTE);
+	GLFunctions::glDisableVertexAttribArray(POSITION_ATTRIBUTE);
+	GLFunctions::glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GLFunctions::glUseProgram(0);
+
+	glTexEnvi(GL_POINT_SPRITE, GL_COORD_REPLACE, GL_FALSE);
+	glDisable(GL_POINT_SPRITE);
+	glDisable(GL_VERTEX_PROGRAM_POINT_SIZE);
+}
+
+const void*
+ParticleRenderer::
+upload(const void* vertices, size_t bytes)
+{
+	// Orphan the previous frame's storage so the driver can hand out a
+	// fresh block instead of waiting for pending draws to finish with it.
+	// Leaves the buffer bound and returns the vertices as an offset into it.
+	GLFunctions::glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	if (bytes > bufferSize)
+		bufferSize = bytes + bytes / 2;
+	GLFunctions::glBufferData(GL_ARRAY_BUFFER, bufferSize, nullptr, GL_STREAM_DRAW);
+	GLFunctions::glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, vertices);
+
+	return nullptr;
+}
+
+void
+ParticleRenderer::
+drawImmediate(const ParticleVertex* vertices, int count)
+{
+	glBegin(GL_POINTS);
+
+	for (int i = 0; i < count; ++i)
+	{
+		const ParticleVertex& vertex = vertices[i];
+		glColor4f(vertex.r, vertex.g, vertex.b, vertex.a);
+		glVertex2f(vertex.x, vertex.y);
+	}
+
+	glEnd();
+}
+
+void
+ParticleRenderer::
+drawArrays(const ParticleVertex* vertices, int count)
+{
+	const char* base = reinterpret_cast<const char*>(vertices);
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(2, GL_FLOAT, sizeof(ParticleVertex), base + offsetof(ParticleVertex, x));
+	glColorPointer(4, GL_FLOAT, sizeof(ParticleVertex), base + offsetof(ParticleVertex, r));
+
+	glDrawArrays(GL_POINTS, 0, count);
+
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+}
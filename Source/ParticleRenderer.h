@@ -0,0 +1,71 @@
+#pragma once
+
+#include "SDL/SDL.h"
+#include "SDL/SDL_opengl.h"
+
+#include "ParticleVertex.h"
+#include "Renderer.h"
+
+// Draws particle vertex streams as blended points with OpenGL.
+class ParticleRenderer : public Renderer
+{
+public:
+	enum Mode
+	{
+		// one glColor/glVertex call per particle, for comparison
+		Immediate,
+		// client-side vertex array, one draw call
+		VertexArray,
+		// client-side array streamed into a buffer object, one draw call
+		VertexBuffer,
+		// position and age streamed into a buffer object, color, fade and
+		// size evaluated by a GLSL point-sprite program
+		Shader,
+		// same with 8-byte quantized vertices and a palette of colors
+		PackedShader
+	};
+
+	// Needs a current GL context
+	ParticleRenderer(Mode mode = VertexBuffer);
+	~ParticleRenderer();
+
+	void setMode(Mode value);
+	Mode getMode();
+
+	// Layout the current mode draws from
+	VertexFormat getVertexFormat() override;
+
+	// Colored vertices go through the fixed-function paths, sprites and
+	// packed particles through the shaders whatever the mode
+	void draw(const ParticleVertex* vertices, int count, float pointSize) override;
+	void draw(const ParticleSprite* vertices, int count, float pointSize, const SDL_Color& color, bool fade) override;
+	void draw(const PackedParticle* vertices, int count, float pointSize, const SDL_Color* palette, int paletteSize, int width, int height) override;
+
+private:
+	ParticleRenderer(const ParticleRenderer&);
+	ParticleRenderer& operator=(const ParticleRenderer&);
+
+	void drawImmediate(const ParticleVertex* vertices, int count);
+	// A linked point-sprite program and its uniforms, -1 when unused
+	struct Program
+	{
+		GLuint id;
+		GLint color;
+		GLint fade;
+		GLint pointSize;
+		GLint palette;
+		GLint viewport;
+	};
+
+	void drawArrays(const ParticleVertex* vertices, int count);
+	const void* upload(const void* vertices, size_t bytes);
+	bool createProgram(Program& program, const char* vertexSource, const char* attribute);
+	void beginSprites(const Program& program, float pointSize);
+	void endSprites();
+
+	Mode mode;
+	GLuint buffer;
+	size_t bufferSize;
+	Program spriteProgram;
+	Program packedProgram;
+};
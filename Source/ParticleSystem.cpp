@@ -0,0 +1,884 @@
+#include "ParticleSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "Extensions.h"
+#include "Integrator.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define PARTICLE_SYSTEM_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	bool
+	sameColor(const SDL_Color& a, const SDL_Color& b)
+	{
+		return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+	}
+
+	// Turns where particles started the step into how far they moved
+	void
+	displace(const float* x, const float* y, float* fromX, float* fromY, int count)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			fromX[i] = x[i] - fromX[i];
+			fromY[i] = y[i] - fromY[i];
+		}
+	}
+}
+
+ParticleSystem::
+ParticleSystem(int width, int height)
+: width(width),
+  height(height),
+  threadPool(nullptr),
+  nextColorIndex(0),
+  motionTime(0),
+  rateScale(1),
+  grid(16, width, height),
+  spatialIndex(false),
+  collider(width, height)
+{
+}
+
+ParticleSystem::
+~ParticleSystem()
+{
+	for (std::vector<Body*>::iterator it = bodies.begin(); it != bodies.end(); ++it)
+		delete *it;
+	for (std::vector<Emitter*>::iterator it = emitters.begin(); it != emitters.end(); ++it)
+		delete *it;
+}
+
+int
+ParticleSystem::
+add(Emitter* emitter)
+{
+	if ((int)emitters.size() >= MAX_EMITTERS)
+		return -1;
+
+	emitter->setRandomStream(emitters.size());
+	emitters.push_back(emitter);
+	emitterGroups.push_back(0);
+	emitterColors.push_back(0);
+	emitterParticles.push_back(0);
+	emitterSpawns.push_back(0);
+	emitterRadii.push_back(0);
+	emitterResponses.push_back(0);
+	emitterRestitutions.push_back(0);
+	emitterOrder.push_back(0);
+	return (int)emitters.size() - 1;
+}
+
+void
+ParticleSystem::
+add(Body* body)
+{
+	bodies.push_back(body);
+	add(body->getEmitter());
+}
+
+int
+ParticleSystem::
+getEmitterCount()
+{
+	return (int)emitters.size();
+}
+
+Emitter*
+ParticleSystem::
+getEmitter(int id)
+{
+	return emitters[id];
+}
+
+int
+ParticleSystem::
+getBodyCount()
+{
+	return (int)bodies.size();
+}
+
+Body*
+ParticleSystem::
+getBody(int index)
+{
+	return bodies[index];
+}
+
+void
+ParticleSystem::
+reserve(int capacity)
+{
+	particles.reserve(capacity);
+	chunkParticles.resize(particles.getChunkCount());
+	chunkVertices.resize(particles.getChunkCount());
+
+	// the vertices grow with the particles, see growVertices(), but no
+	// further than there can be particles
+	if (vertices.capacity() > capacity)
+	{
+		vertices.reserve(capacity);
+		sorted.reserve(0);
+		std::vector<unsigned short>(capacity).swap(vertexGroups);
+	}
+}
+
+void
+ParticleSystem::
+growVertices(int count)
+{
+	vertices.grow(std::min(count, particles.capacity()));
+	if ((int)vertexGroups.size() < vertices.capacity())
+		vertexGroups.resize(vertices.capacity());
+}
+
+void
+ParticleSystem::
+update(float deltaTime)
+{
+	for (std::vector<Body*>::iterator it = bodies.begin(); it != bodies.end(); ++it)
+		(*it)->update();
+
+	nbody.apply(particles, bodies, deltaTime, threadPool);
+	forces.prepare(deltaTime);
+	obstacles.prepare();
+	for (int id = 0; id < (int)emitters.size() && !obstacles.isEmpty(); ++id)
+	{
+		emitterResponses[id] = (unsigned char)emitters[id]->getCollisionResponse();
+		emitterRestitutions[id] = emitters[id]->getRestitution();
+	}
+
+	// room for every emitter's particles
+	long long capacity = 0;
+	for (std::vector<Emitter*>::iterator it = emitters.begin(); it != emitters.end(); ++it)
+		capacity += (*it)->getMaxParticles();
+	capacity = std::min(capacity, (long long)Emitter::MAX_PARTICLES);
+	if (capacity != particles.capacity())
+		reserve((int)capacity);
+
+	assignGroups();
+
+	// Process every chunk in place, in parallel when there is a thread pool,
+	// then close the gaps left by dead particles in chunk order so the result
+	// is deterministic however many threads run the update.
+	const int CHUNK_SIZE = ParticleBuffer::CHUNK_SIZE;
+	int count = particles.size();
+	int chunks = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	motionTime = deltaTime;
+	growVertices(count);
+	if (threadPool)
+		threadPool->run(chunks, [this, deltaTime](int chunk) { process(chunk, deltaTime); });
+	else
+		for (int chunk = 0; chunk < chunks; ++chunk)
+			process(chunk, deltaTime);
+
+	int alive = 0;
+	int vertexCount = 0;
+	bool grouped = groups.size() > 1;
+	for (int chunk = 0; chunk < chunks; ++chunk)
+	{
+		int begin = chunk * CHUNK_SIZE;
+		particles.move(begin, alive, chunkParticles[chunk]);
+		alive += chunkParticles[chunk];
+
+		vertices.move(begin, vertexCount, chunkVertices[chunk]);
+		if (grouped && begin != vertexCount)
+			std::memmove(vertexGroups.data() + vertexCount, vertexGroups.data() + begin, chunkVertices[chunk] * sizeof(unsigned short));
+		vertexCount += chunkVertices[chunk];
+	}
+	particles.resize(alive);
+	vertices.resize(vertexCount);
+
+	// colliding particles move after the update pass, so their vertices are
+	// only written once they have been separated
+	if (collider.getIterations() > 0)
+	{
+		for (int id = 0; id < (int)emitters.size(); ++id)
+			emitterRadii[id] = emitters[id]->getParticleSize() * 0.5f;
+		collider.resolve(particles, emitterRadii, deltaTime, threadPool);
+
+		chunks = (alive + CHUNK_SIZE - 1) / CHUNK_SIZE;
+		if (threadPool)
+			threadPool->run(chunks, [this, deltaTime](int chunk) { finish(chunk, deltaTime); });
+		else
+			for (int chunk = 0; chunk < chunks; ++chunk)
+				finish(chunk, deltaTime);
+
+		vertexCount = 0;
+		for (int chunk = 0; chunk < chunks; ++chunk)
+		{
+			int begin = chunk * CHUNK_SIZE;
+			vertices.move(begin, vertexCount, chunkVertices[chunk]);
+			if (grouped && begin != vertexCount)
+				std::memmove(vertexGroups.data() + vertexCount, vertexGroups.data() + begin, chunkVertices[chunk] * sizeof(unsigned short));
+			vertexCount += chunkVertices[chunk];
+		}
+		vertices.resize(vertexCount);
+	}
+
+	// create new ones, without going over any emitter's limit
+	bool counted = false;
+	for (int id = 0; id < (int)emitters.size(); ++id)
+	{
+		Emitter* emitter = emitters[id];
+		if (!emitter->getEnabled())
+		{
+			emitterSpawns[id] = 0;
+			continue;
+		}
+
+		// low rates spawn a particle every few steps rather than one each
+		float due = emitterSpawns[id] + emitter->getRate() * rateScale * deltaTime;
+		int spawns = std::min((int)due, particles.capacity() - particles.size());
+		emitterSpawns[id] = due - (int)due;
+		if (emitterParticles[id] + spawns > emitter->getMaxParticles() && !counted)
+		{
+			countParticles();
+			counted = true;
+		}
+
+		spawns = std::min(spawns, emitter->getMaxParticles() - emitterParticles[id]);
+		if (spawns <= 0)
+			continue;
+
+		emitter->spawn(particles, spawns, (unsigned short)id, getColorIndex(id));
+		emitterParticles[id] += spawns;
+	}
+
+	// new particles are drawn where they were spawned, without motion
+	motionTime = 0;
+	growVertices(particles.size());
+	vertices.resize(vertexCount + emit(alive, particles.size(), vertexCount));
+
+	sortGroups();
+
+	if (spatialIndex)
+		grid.build(particles, threadPool);
+}
+
+void
+ParticleSystem::
+assignGroups()
+{
+	// Emitters drawn with the same settings share a group: the same size,
+	// and for sprites, which take it from the group, the same color and fade.
+	// Sorting keeps the groups in order of size.
+	bool sprites = vertices.getFormat() == SpriteVertex;
+	auto less = [this, sprites](int a, int b)
+	{
+		Emitter* first = emitters[a];
+		Emitter* second = emitters[b];
+		if (first->getParticleSize() != second->getParticleSize())
+			return first->getParticleSize() < second->getParticleSize();
+		if (!sprites)
+			return false;
+
+		SDL_Color c = first->getColor();
+		SDL_Color d = second->getColor();
+		Uint32 x = (Uint32(c.r) << 24) | (c.g << 16) | (c.b << 8) | c.a;
+		Uint32 y = (Uint32(d.r) << 24) | (d.g << 16) | (d.b << 8) | d.a;
+		if (x != y)
+			return x < y;
+
+		return first->getFade() < second->getFade();
+	};
+
+	for (int id = 0; id < (int)emitters.size(); ++id)
+		emitterOrder[id] = id;
+	std::sort(emitterOrder.begin(), emitterOrder.end(), less);
+
+	groups.clear();
+	for (int i = 0; i < (int)emitterOrder.size(); ++i)
+	{
+		int id = emitterOrder[i];
+		if (i == 0 || less(emitterOrder[i - 1], id))
+		{
+			Emitter* emitter = emitters[id];
+			VertexGroup group = { 0, 0, emitter->getParticleSize(), emitter->getColor(), emitter->getFade() };
+			groups.push_back(group);
+		}
+
+		emitterGroups[id] = (unsigned short)(groups.size() - 1);
+	}
+}
+
+void
+ParticleSystem::
+countParticles()
+{
+	std::fill(emitterParticles.begin(), emitterParticles.end(), 0);
+
+	int count = particles.size();
+	for (int begin = 0; begin < count; begin += ParticleBuffer::CHUNK_SIZE)
+	{
+		const ParticleChunk& chunk = particles.getChunk(begin / ParticleBuffer::CHUNK_SIZE);
+		int size = std::min(ParticleBuffer::CHUNK_SIZE, count - begin);
+		for (int i = 0; i < size; ++i)
+			++emitterParticles[chunk.emitter[i]];
+	}
+}
+
+void
+ParticleSystem::
+sortGroups()
+{
+	int count = vertices.size();
+	if (groups.size() <= 1)
+	{
+		if (!groups.empty())
+		{
+			groups[0].first = 0;
+			groups[0].count = count;
+		}
+		return;
+	}
+
+	// Counting sort of the vertices by group, stable so every group keeps
+	// the order the particles were spawned in
+	for (VertexGroup& group : groups)
+		group.count = 0;
+	for (int i = 0; i < count; ++i)
+		++groups[vertexGroups[i]].count;
+
+	groupOffsets.resize(groups.size());
+	int first = 0;
+	for (size_t g = 0; g < groups.size(); ++g)
+	{
+		groups[g].first = first;
+		groupOffsets[g] = first;
+		first += groups[g].count;
+	}
+
+	sorted.setFormat(vertices.getFormat());
+	sorted.setMotion(vertices.hasMotion());
+	if (sorted.capacity() < count)
+		sorted.reserve(vertices.capacity());
+	sorted.resize(count);
+
+	int stride = vertices.getStride();
+	const unsigned char* from = static_cast<const unsigned char*>(vertices.data());
+	unsigned char* to = static_cast<unsigned char*>(sorted.at(0));
+	const float* motion = vertices.getMotion();
+	for (int i = 0; i < count; ++i)
+	{
+		int index = groupOffsets[vertexGroups[i]]++;
+		std::memcpy(to + (size_t)index * stride, from + (size_t)i * stride, stride);
+		if (motion)
+		{
+			float* displacement = sorted.motionAt(index);
+			displacement[0] = motion[i * 2];
+			displacement[1] = motion[i * 2 + 1];
+		}
+	}
+
+	vertices.swap(sorted);
+}
+
+unsigned char
+ParticleSystem::
+getColorIndex(int emitter)
+{
+	// Give the emitter's color a palette slot. Once the palette is full the
+	// oldest slot is reused, recoloring packed particles that still refer
+	// to it.
+	SDL_Color color = emitters[emitter]->getColor();
+	unsigned char& slot = emitterColors[emitter];
+	if (slot < palette.size() && sameColor(palette[slot], color))
+		return slot;
+
+	for (int i = 0; i < (int)palette.size(); ++i)
+	{
+		if (sameColor(palette[i], color))
+		{
+			slot = (unsigned char)i;
+			return slot;
+		}
+	}
+
+	slot = (unsigned char)nextColorIndex;
+	nextColorIndex = (nextColorIndex + 1) % PALETTE_SIZE;
+	if (slot < palette.size())
+		palette[slot] = color;
+	else
+		palette.push_back(color);
+
+	return slot;
+}
+
+void
+ParticleSystem::
+process(int chunk, float deltaTime)
+{
+	// Fused pass: for each block, compact the survivors towards the front of
+	// the chunk, apply the force fields, integrate them and stop them at
+	// obstacles while the block is still in cache, and write the ones that
+	// remain alive and on screen to the chunk's slice of the vertex stream.
+	// Every particle is touched once per frame, and a mass expiration costs
+	// the same as a regular frame.
+	ParticleChunk& data = particles.getChunk(chunk);
+	int begin = chunk * ParticleBuffer::CHUNK_SIZE;
+	int size = std::min(ParticleBuffer::CHUNK_SIZE, particles.size() - begin);
+	int alive = 0;
+	int emitted = 0;
+	// colliding particles are only stopped at obstacles and written once they
+	// have been separated, in finish()
+	bool emitting = collider.getIterations() == 0;
+	bool obstructed = !obstacles.isEmpty() && emitting;
+	float fromX[BLOCK_SIZE];
+	float fromY[BLOCK_SIZE];
+	for (int block = 0; block < size; block += BLOCK_SIZE)
+	{
+		int blockEnd = std::min(block + BLOCK_SIZE, size);
+		int first = alive;
+		for (int i = block; i < blockEnd; ++i)
+		{
+			if (data.isDead(i))
+				continue;
+
+			if (alive != i)
+				data.move(i, alive);
+
+			++alive;
+		}
+
+		if (!forces.isEmpty())
+			forces.apply(data, first, alive);
+		if (obstructed)
+		{
+			std::copy(data.x + first, data.x + alive, fromX);
+			std::copy(data.y + first, data.y + alive, fromY);
+		}
+		Integrator::integrate(data.x + first, data.y + first, data.vx + first, data.vy + first, data.age + first, data.gravity + first, alive - first, deltaTime);
+		if (obstructed)
+			obstacles.collide(data, first, alive, fromX, fromY, emitterResponses.data(), emitterRestitutions.data());
+		if (!emitting)
+			continue;
+
+		// the particles obstacles stopped or turned around didn't move by
+		// their velocity
+		bool moved = obstructed && vertices.hasMotion();
+		if (moved)
+			displace(data.x + first, data.y + first, fromX, fromY, alive - first);
+		emitted += emit(data, first, alive, begin + emitted, moved ? fromX : nullptr, moved ? fromY : nullptr);
+	}
+
+	chunkParticles[chunk] = alive;
+	chunkVertices[chunk] = emitted;
+}
+
+void
+ParticleSystem::
+finish(int chunk, float deltaTime)
+{
+	// Stops the particles of a chunk at obstacles after the collider moved
+	// them, so pushes from their neighbours can't carry them through, then
+	// writes them to the chunk's slice of the vertex stream. The collider
+	// added what it moved them by to their velocity, so stepping back by it
+	// still finds where they started.
+	ParticleChunk& data = particles.getChunk(chunk);
+	int begin = chunk * ParticleBuffer::CHUNK_SIZE;
+	int size = std::min(ParticleBuffer::CHUNK_SIZE, particles.size() - begin);
+	int emitted = 0;
+	bool obstructed = !obstacles.isEmpty();
+	float fromX[BLOCK_SIZE];
+	float fromY[BLOCK_SIZE];
+	for (int block = 0; block < size; block += BLOCK_SIZE)
+	{
+		int blockEnd = std::min(block + BLOCK_SIZE, size);
+		if (obstructed)
+		{
+			for (int i = block; i < blockEnd; ++i)
+			{
+				fromX[i - block] = data.x[i] - data.vx[i] * deltaTime;
+				fromY[i - block] = data.y[i] - data.vy[i] * deltaTime;
+			}
+			obstacles.collide(data, block, blockEnd, fromX, fromY, emitterResponses.data(), emitterRestitutions.data());
+			displace(data.x + block, data.y + block, fromX, fromY, blockEnd - block);
+		}
+		emitted += emit(data, block, blockEnd, begin + emitted, obstructed ? fromX : nullptr, obstructed ? fromY : nullptr);
+	}
+
+	chunkVertices[chunk] = emitted;
+}
+
+int
+ParticleSystem::
+emit(int begin, int end, int vertex)
+{
+	int emitted = 0;
+	while (begin < end)
+	{
+		int chunk = begin / ParticleBuffer::CHUNK_SIZE;
+		int offset = begin % ParticleBuffer::CHUNK_SIZE;
+		int n = std::min(end - begin, ParticleBuffer::CHUNK_SIZE - offset);
+		emitted += emit(particles.getChunk(chunk), offset, offset + n, vertex + emitted);
+		begin += n;
+	}
+
+	return emitted;
+}
+
+int
+ParticleSystem::
+emit(const ParticleChunk& data, int begin, int end, int vertex, const float* moveX, const float* moveY)
+{
+	float* motion = vertices.hasMotion() ? vertices.motionAt(vertex) : nullptr;
+	unsigned short* group = groups.size() > 1 ? vertexGroups.data() + vertex : nullptr;
+	switch (vertices.getFormat())
+	{
+	case SpriteVertex:
+		return emitSprites(data, begin, end, static_cast<ParticleSprite*>(vertices.at(vertex)), motion, group, moveX, moveY);
+
+	case PackedVertex:
+		return emitPacked(data, begin, end, static_cast<PackedParticle*>(vertices.at(vertex)), motion, group, moveX, moveY);
+
+	default:
+		return emitColored(data, begin, end, static_cast<ParticleVertex*>(vertices.at(vertex)), motion, group, moveX, moveY);
+	}
+}
+
+int
+ParticleSystem::
+emitColored(const ParticleChunk& data, int begin, int end, ParticleVertex* out, float* motion, unsigned short* group, const float* moveX, const float* moveY)
+{
+	ParticleVertex* vertex = out;
+	for (int i = begin; i < end; ++i)
+	{
+		if (data.isDead(i) || !data.isInside(i, 0, 0, width, height))
+			continue;
+
+		const SDL_Color& c = data.color[i];
+		float age = data.age[i];
+		float lifetime = data.lifetime[i];
+
+		vertex->x = data.x[i];
+		vertex->y = data.y[i];
+		vertex->r = c.r / 255.f;
+		vertex->g = c.g / 255.f;
+		vertex->b = c.b / 255.f;
+		vertex->a = (data.fade[i] ? 1 - std::clamp(age / (lifetime - age), 0.0, 1.0) : 1) * c.a / 255.f;
+		tag(data, i, vertex - out, motion, group, moveX, moveY, begin);
+		++vertex;
+	}
+
+	return vertex - out;
+}
+
+int
+ParticleSystem::
+emitSprites(const ParticleChunk& data, int begin, int end, ParticleSprite* out, float* motion, unsigned short* group, const float* moveX, const float* moveY)
+{
+	// the shader derives the color and fade from the age
+	ParticleSprite* vertex = out;
+	for (int i = begin; i < end; ++i)
+	{
+		if (data.isDead(i) || !data.isInside(i, 0, 0, width, height))
+			continue;
+
+		vertex->x = data.x[i];
+		vertex->y = data.y[i];
+		vertex->age = data.age[i] / data.lifetime[i];
+		tag(data, i, vertex - out, motion, group, moveX, moveY, begin);
+		++vertex;
+	}
+
+	return vertex - out;
+}
+
+int
+ParticleSystem::
+emitPacked(const ParticleChunk& data, int begin, int end, PackedParticle* out, float* motion, unsigned short* group, const float* moveX, const float* moveY)
+{
+	// Quantizes four particles at a time, then stores the ones that are
+	// alive and on screen. Positions are scaled to 0..65535 across the
+	// viewport, so they cannot overflow once culled.
+	float scaleX = 65535.f / width;
+	float scaleY = 65535.f / height;
+	PackedParticle* vertex = out;
+	int i = begin;
+
+#if defined(PARTICLE_SYSTEM_SSE2)
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 right = _mm_set1_ps((float)width);
+	const __m128 bottom = _mm_set1_ps((float)height);
+	const __m128 scaleX4 = _mm_set1_ps(scaleX);
+	const __m128 scaleY4 = _mm_set1_ps(scaleY);
+	const __m128 scaleAge4 = _mm_set1_ps(255.f);
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(data.x + i);
+		__m128 y = _mm_loadu_ps(data.y + i);
+		__m128 age = _mm_loadu_ps(data.age + i);
+		__m128 lifetime = _mm_loadu_ps(data.lifetime + i);
+
+		__m128 visible = _mm_and_ps(_mm_cmplt_ps(age, lifetime),
+			_mm_and_ps(_mm_and_ps(_mm_cmpge_ps(x, zero), _mm_cmple_ps(x, right)),
+					   _mm_and_ps(_mm_cmpge_ps(y, zero), _mm_cmple_ps(y, bottom))));
+		int mask = _mm_movemask_ps(visible);
+		if (!mask)
+			continue;
+
+		// rounds to nearest
+		int qx[4], qy[4], qage[4];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(qx), _mm_cvtps_epi32(_mm_mul_ps(x, scaleX4)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(qy), _mm_cvtps_epi32(_mm_mul_ps(y, scaleY4)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(qage), _mm_cvtps_epi32(_mm_mul_ps(_mm_div_ps(age, lifetime), scaleAge4)));
+
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			if (!(mask & (1 << lane)))
+				continue;
+
+			vertex->x = (unsigned short)qx[lane];
+			vertex->y = (unsigned short)qy[lane];
+			vertex->age = (unsigned char)qage[lane];
+			vertex->color = data.colorIndex[i + lane];
+			vertex->fade = data.fade[i + lane];
+			vertex->padding = 0;
+			tag(data, i + lane, vertex - out, motion, group, moveX, moveY, begin);
+			++vertex;
+		}
+	}
+#endif
+
+	for (; i < end; ++i)
+	{
+		if (data.isDead(i) || !data.isInside(i, 0, 0, width, height))
+			continue;
+
+		vertex->x = (unsigned short)(data.x[i] * scaleX + 0.5f);
+		vertex->y = (unsigned short)(data.y[i] * scaleY + 0.5f);
+		vertex->age = (unsigned char)(data.age[i] / data.lifetime[i] * 255.f + 0.5f);
+		vertex->color = data.colorIndex[i];
+		vertex->fade = data.fade[i];
+		vertex->padding = 0;
+		tag(data, i, vertex - out, motion, group, moveX, moveY, begin);
+		++vertex;
+	}
+
+	return vertex - out;
+}
+
+void
+ParticleSystem::
+tag(const ParticleChunk& data, int particle, int vertex, float* motion, unsigned short* group, const float* moveX, const float* moveY, int begin)
+{
+	// The integrator moves a particle by its updated velocity times the step,
+	// and the collider adds what it moves it by to its velocity, so that is
+	// how far it travelled since the previous update unless an obstacle
+	// stopped or bounced it, which the caller then measured
+	if (motion && moveX)
+	{
+		motion[vertex * 2] = moveX[particle - begin];
+		motion[vertex * 2 + 1] = moveY[particle - begin];
+	}
+	else if (motion)
+	{
+		motion[vertex * 2] = data.vx[particle] * motionTime;
+		motion[vertex * 2 + 1] = data.vy[particle] * motionTime;
+	}
+
+	if (group)
+		group[vertex] = emitterGroups[data.emitter[particle]];
+}
+
+void
+ParticleSystem::
+render(Renderer& renderer)
+{
+	bodySnapshots.resize(bodies.size());
+	for (size_t i = 0; i < bodies.size(); ++i)
+	{
+		BodySnapshot& body = bodySnapshots[i];
+		body.position = bodies[i]->position;
+		body.previousPosition = bodies[i]->position;
+		body.size = bodies[i]->getSize();
+		body.color = bodies[i]->getColor();
+	}
+
+	BodySnapshot::draw(renderer, bodySnapshots);
+	ParticleSnapshot::draw(renderer, vertices, groups, palette, width, height);
+}
+
+void
+ParticleSystem::
+snapshot(Snapshot& out)
+{
+	// The stream is rebuilt from scratch every update, so the system can
+	// carry on with the snapshot's old buffer
+	ParticleSnapshot& particles = out.particles;
+	vertices.swap(particles.vertices);
+	vertices.setFormat(particles.vertices.getFormat());
+	vertices.setMotion(particles.vertices.hasMotion());
+	vertices.clear();
+
+	particles.groups = groups;
+	particles.palette = palette;
+	particles.width = width;
+	particles.height = height;
+
+	out.bodies.resize(bodies.size());
+	for (size_t i = 0; i < bodies.size(); ++i)
+	{
+		BodySnapshot& body = out.bodies[i];
+		body.position = bodies[i]->position;
+		body.previousPosition = bodies[i]->previousPosition;
+		body.size = bodies[i]->getSize();
+		body.color = bodies[i]->getColor();
+	}
+}
+
+void
+ParticleSystem::
+setThreadPool(ThreadPool* value)
+{
+	threadPool = value;
+}
+
+ThreadPool*
+ParticleSystem::
+getThreadPool()
+{
+	return threadPool;
+}
+
+void
+ParticleSystem::
+setVertexFormat(VertexFormat value)
+{
+	vertices.setFormat(value);
+}
+
+VertexFormat
+ParticleSystem::
+getVertexFormat()
+{
+	return vertices.getFormat();
+}
+
+void
+ParticleSystem::
+setInterpolation(bool value)
+{
+	vertices.setMotion(value);
+}
+
+bool
+ParticleSystem::
+getInterpolation()
+{
+	return vertices.hasMotion();
+}
+
+void
+ParticleSystem::
+setRateScale(float value)
+{
+	rateScale = value < 0 ? 0 : value > 1 ? 1 : value;
+}
+
+float
+ParticleSystem::
+getRateScale()
+{
+	return rateScale;
+}
+
+void
+ParticleSystem::
+setSpatialIndex(bool value)
+{
+	spatialIndex = value;
+	if (!spatialIndex)
+		grid.clear();
+}
+
+bool
+ParticleSystem::
+getSpatialIndex()
+{
+	return spatialIndex;
+}
+
+const SpatialGrid&
+ParticleSystem::
+getSpatialGrid()
+{
+	return grid;
+}
+
+void
+ParticleSystem::
+setCollisionIterations(int value)
+{
+	collider.setIterations(value);
+}
+
+int
+ParticleSystem::
+getCollisionIterations()
+{
+	return collider.getIterations();
+}
+
+ParticleCollider::Timings
+ParticleSystem::
+getCollisionTimings()
+{
+	return collider.getTimings();
+}
+
+NBodySolver&
+ParticleSystem::
+getNBodySolver()
+{
+	return nbody;
+}
+
+ForceField&
+ParticleSystem::
+getForceField()
+{
+	return forces;
+}
+
+ColliderWorld&
+ParticleSystem::
+getColliderWorld()
+{
+	return obstacles;
+}
+
+const ParticleBuffer&
+ParticleSystem::
+getParticles()
+{
+	return particles;
+}
+
+int
+ParticleSystem::
+getParticleCount()
+{
+	return particles.size();
+}
+
+int
+ParticleSystem::
+getAllocationCount()
+{
+	return particles.getAllocationCount();
+}
+
+const std::vector<SDL_Color>&
+ParticleSystem::
+getPalette()
+{
+	return palette;
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <vector>
+
+#include "SDL/SDL.h"
+
+#include "Body.h"
+#include "ColliderWorld.h"
+#include "Emitter.h"
+#include "ForceField.h"
+#include "NBodySolver.h"
+#include "ParticleBuffer.h"
+#include "ParticleCollider.h"
+#include "ParticleVertex.h"
+#include "Renderer.h"
+#include "Snapshot.h"
+#include "SpatialGrid.h"
+#include "ThreadPool.h"
+#include "VertexStream.h"
+
+// Updates and draws the particles of any number of emitters. They all live
+// in one ParticleBuffer, tagged with the id of the emitter that spawned
+// them, and go through one fused update pass. Their vertices end up in one
+// VertexStream sorted into groups that share the same draw settings, so the
+// renderer issues one draw per particle size rather than one per emitter,
+// and a thousand emitters cost about what one does with as many particles.
+class ParticleSystem
+{
+public:
+	// Number of particles the fused update pass handles at a time, small
+	// enough for one block of every attribute array to stay in L1
+	static const int BLOCK_SIZE = 256;
+
+	// Emitter ids are stored in 16 bits
+	static const int MAX_EMITTERS = 65536;
+
+	// Distinct colors packed vertices can refer to at once, across all the
+	// emitters
+	static const int PALETTE_SIZE = PackedParticle::PALETTE_SIZE;
+
+private:
+	int width;
+	int height;
+	ParticleBuffer particles;
+	VertexStream vertices;
+	// vertices sorted by group
+	VertexStream sorted;
+	// group of every vertex, when there is more than one
+	std::vector<unsigned short> vertexGroups;
+	std::vector<VertexGroup> groups;
+	std::vector<int> groupOffsets;
+	std::vector<int> chunkParticles;
+	std::vector<int> chunkVertices;
+	ThreadPool* threadPool;
+	std::vector<Emitter*> emitters;
+	std::vector<Body*> bodies;
+	std::vector<BodySnapshot> bodySnapshots;
+	// per emitter: draw group, palette slot, an upper bound of the particles
+	// alive, recounted when it gets in the way of spawning, the fraction of a
+	// particle carried over to the next spawn, the radius particles collide
+	// with and how they respond to obstacles
+	std::vector<unsigned short> emitterGroups;
+	std::vector<unsigned char> emitterColors;
+	std::vector<int> emitterParticles;
+	std::vector<float> emitterSpawns;
+	std::vector<float> emitterRadii;
+	std::vector<unsigned char> emitterResponses;
+	std::vector<float> emitterRestitutions;
+	std::vector<int> emitterOrder;
+	std::vector<SDL_Color> palette;
+	int nextColorIndex;
+	float motionTime;
+	float rateScale;
+	SpatialGrid grid;
+	bool spatialIndex;
+	ParticleCollider collider;
+	NBodySolver nbody;
+	ForceField forces;
+	ColliderWorld obstacles;
+
+	void reserve(int capacity);
+	void growVertices(int count);
+	void assignGroups();
+	void countParticles();
+	void sortGroups();
+	unsigned char getColorIndex(int emitter);
+	void process(int chunk, float deltaTime);
+	void finish(int chunk, float deltaTime);
+	// moveX and moveY, when given, hold how far the particles from begin
+	// moved during the update, otherwise their velocity says
+	int emit(const ParticleChunk& chunk, int begin, int end, int vertex, const float* moveX = nullptr, const float* moveY = nullptr);
+	int emit(int begin, int end, int vertex);
+	int emitColored(const ParticleChunk& chunk, int begin, int end, ParticleVertex* out, float* motion, unsigned short* group, const float* moveX, const float* moveY);
+	int emitSprites(const ParticleChunk& chunk, int begin, int end, ParticleSprite* out, float* motion, unsigned short* group, const float* moveX, const float* moveY);
+	int emitPacked(const ParticleChunk& chunk, int begin, int end, PackedParticle* out, float* motion, unsigned short* group, const float* moveX, const float* moveY);
+	void tag(const ParticleChunk& chunk, int particle, int vertex, float* motion, unsigned short* group, const float* moveX, const float* moveY, int begin);
+
+public:
+	ParticleSystem(int width = 200, int height = 200);
+
+	// Deletes the bodies and emitters it was given
+	~ParticleSystem();
+
+	// Takes ownership of the emitter and returns its id
+	int add(Emitter* emitter);
+
+	// Takes ownership of the body and of its emitter
+	void add(Body* body);
+
+	int getEmitterCount();
+	Emitter* getEmitter(int id);
+
+	int getBodyCount();
+	Body* getBody(int index);
+
+	// Moves the bodies, updates every particle, spawns new ones and
+	// rebuilds the vertex stream
+	void update(float deltaTime);
+	void render(Renderer& renderer);
+
+	// Hands the vertex stream of the last update over to the snapshot,
+	// without copying; render() draws no particles until the next update
+	void snapshot(Snapshot& out);
+
+	void setThreadPool(ThreadPool* value);
+	ThreadPool* getThreadPool();
+
+	// Layout of the vertex stream, to match the renderer; switching drops
+	// the current frame's vertices
+	void setVertexFormat(VertexFormat value);
+	VertexFormat getVertexFormat();
+
+	// Whether the vertex stream records how far every particle moved during
+	// the last update, so snapshots can be drawn in between updates
+	void setInterpolation(bool value);
+	bool getInterpolation();
+
+	// Factor every emitter's spawn rate is multiplied with, to shed load
+	// while the simulation can't keep up
+	void setRateScale(float value);
+	float getRateScale();
+
+	// Whether every update ends by rebuilding a SpatialGrid over the
+	// particles, for queries until the next update
+	void setSpatialIndex(bool value);
+	bool getSpatialIndex();
+	const SpatialGrid& getSpatialGrid();
+
+	// Separation passes run every update on the particles that overlap, as
+	// discs half their particle size across; 0 lets them pass through each
+	// other
+	void setCollisionIterations(int value);
+	int getCollisionIterations();
+	ParticleCollider::Timings getCollisionTimings();
+
+	// Forces between the bodies and the particles, applied at the start of
+	// every update
+	NBodySolver& getNBodySolver();
+
+	// Attractors, vortices, winds and drags, applied to every particle in
+	// the update pass
+	ForceField& getForceField();
+
+	// Static obstacles the particles of every emitter respond to as the
+	// emitter says, tested in the update pass
+	ColliderWorld& getColliderWorld();
+
+	const ParticleBuffer& getParticles();
+	int getParticleCount();
+	int getAllocationCount();
+
+	// Colors of the particles alive, indexed by PackedParticle::color. Once
+	// more than PALETTE_SIZE colors are in use the oldest slots are reused,
+	// recoloring the packed particles that still refer to them.
+	const std::vector<SDL_Color>& getPalette();
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+// Layouts an emitter can write its render vertex stream in
+enum VertexFormat
+{
+	// ParticleVertex, for the fixed-function paths
+	ColoredVertex,
+	// ParticleSprite, for the shader path
+	SpriteVertex,
+	// PackedParticle, for the packed shader path
+	PackedVertex
+};
+
+// A particle as written to the render vertex stream: screen position and
+// final color, with fade already applied to the alpha.
+struct ParticleVertex
+{
+	float x;
+	float y;
+	float r;
+	float g;
+	float b;
+	float a;
+};
+
+// A particle for the shader path: screen position and age as a fraction of
+// the lifetime. Color, fade and size are per-emitter uniforms.
+struct ParticleSprite
+{
+	float x;
+	float y;
+	float age;
+};
+
+// A particle quantized to 8 bytes for the packed shader path, a third of a
+// ParticleVertex. Position is 16-bit fixed point relative to the viewport,
+// about 1/64 of a pixel apart across the default window size.
+struct PackedParticle
+{
+	// Distinct colors the color byte can refer to
+	static const int PALETTE_SIZE = 64;
+
+	// position as a fraction of the viewport width and height, 0 to 65535
+	unsigned short x;
+	unsigned short y;
+	// age as a fraction of the lifetime, 0 to 255
+	unsigned char age;
+	// slot in the emitter's palette
+	unsigned char color;
+	// 1 when the particle fades out
+	unsigned char fade;
+	unsigned char padding;
+};
@@ -0,0 +1,385 @@
+#include "QuadTree.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Spreads the low bits of a value to the even bits
+	int
+	spreadBits(int value)
+	{
+		int result = 0;
+		for (int bit = 0; bit < QuadTree::TOP_DEPTH; ++bit)
+			result |= ((value >> bit) & 1) << (2 * bit);
+		return result;
+	}
+
+	// Gathers the even bits of a Morton code
+	int
+	compactBits(int value)
+	{
+		int result = 0;
+		for (int bit = 0; bit < QuadTree::TOP_DEPTH; ++bit)
+			result |= ((value >> (2 * bit)) & 1) << bit;
+		return result;
+	}
+
+	// Inputs are split in slices of at least this many points
+	const int MIN_SLICE = 4096;
+}
+
+QuadTree::
+QuadTree()
+: left(0),
+  top(0),
+  size(1)
+{
+	std::fill(bucketStart, bucketStart + BUCKETS + 1, 0);
+}
+
+void
+QuadTree::
+clear()
+{
+	nodes.clear();
+	points.clear();
+}
+
+int
+QuadTree::
+getBucket(float x, float y) const
+{
+	const int SIDE = 1 << TOP_DEPTH;
+	float scale = SIDE / size;
+	int column = std::min(std::max((int)((x - left) * scale), 0), SIDE - 1);
+	int row = std::min(std::max((int)((y - top) * scale), 0), SIDE - 1);
+	return spreadBits(column) | (spreadBits(row) << 1);
+}
+
+void
+QuadTree::
+build(const float* x, const float* y, const float* mass, int count, ThreadPool* threadPool)
+{
+	if (count <= 0)
+	{
+		clear();
+		return;
+	}
+
+	points.resize(count);
+	pointBuckets.resize(count);
+	bound(x, y, count, threadPool);
+
+	// counting sort into the buckets, one slice of the input per thread, so
+	// the points of a bucket keep their input order however many run
+	int slices = threadPool ? std::max(std::min(threadPool->getThreadCount(), count / MIN_SLICE), 1) : 1;
+	sliceBuckets.assign((size_t)slices * BUCKETS, 0);
+	if (threadPool)
+		threadPool->run(slices, [this, x, y, count, slices](int slice) { countSlice(x, y, count, slice, slices); });
+	else
+		countSlice(x, y, count, 0, 1);
+
+	int offset = 0;
+	for (int bucket = 0; bucket < BUCKETS; ++bucket)
+	{
+		bucketStart[bucket] = offset;
+		for (int slice = 0; slice < slices; ++slice)
+		{
+			int& n = sliceBuckets[slice * BUCKETS + bucket];
+			int start = offset;
+			offset += n;
+			n = start;
+		}
+	}
+	bucketStart[BUCKETS] = offset;
+
+	if (threadPool)
+		threadPool->run(slices, [this, x, y, mass, count, slices](int slice) { scatterSlice(x, y, mass, count, slice, slices); });
+	else
+		scatterSlice(x, y, mass, count, 0, 1);
+
+	// every bucket's subtree on its own
+	bucketNodes.resize(BUCKETS);
+	bucketLeaves.resize(BUCKETS);
+	if (threadPool)
+		threadPool->run(BUCKETS, [this](int bucket) { buildBucket(bucket); });
+	else
+		for (int bucket = 0; bucket < BUCKETS; ++bucket)
+			buildBucket(bucket);
+
+	// The levels above the buckets are laid out one after the other, a node
+	// of Morton code q at a level having its children at 4q on the next, so
+	// the bucket roots come last and in order. The rest of every subtree
+	// follows them.
+	int next = TOP_NODES + BUCKETS;
+	int leafCount = 0;
+	for (int bucket = 0; bucket < BUCKETS; ++bucket)
+	{
+		bucketOffsets[bucket] = next - 1;
+		next += (int)bucketNodes[bucket].size() - 1;
+		leafCount += (int)bucketLeaves[bucket].size();
+	}
+	nodes.resize(next);
+	leaves.clear();
+	leaves.reserve(leafCount);
+	for (int bucket = 0; bucket < BUCKETS; ++bucket)
+		for (std::vector<int>::iterator it = bucketLeaves[bucket].begin(); it != bucketLeaves[bucket].end(); ++it)
+			leaves.push_back(*it == 0 ? TOP_NODES + bucket : bucketOffsets[bucket] + *it);
+
+	auto place = [this](int bucket)
+	{
+		const std::vector<Node>& tree = bucketNodes[bucket];
+		int offset = bucketOffsets[bucket];
+		for (int i = 0; i < (int)tree.size(); ++i)
+		{
+			Node& node = nodes[i == 0 ? TOP_NODES + bucket : offset + i];
+			node = tree[i];
+			if (node.children >= 0)
+				node.children += offset;
+		}
+	};
+	if (threadPool)
+		threadPool->run(BUCKETS, place);
+	else
+		for (int bucket = 0; bucket < BUCKETS; ++bucket)
+			place(bucket);
+
+	int levelOffset = TOP_NODES;
+	for (int level = TOP_DEPTH - 1; level >= 0; --level)
+	{
+		int levelNodes = 1 << (2 * level);
+		int childOffset = levelOffset;
+		levelOffset -= levelNodes;
+		float side = size / (1 << level);
+		for (int code = 0; code < levelNodes; ++code)
+		{
+			Node& node = nodes[levelOffset + code];
+			node.left = left + compactBits(code) * side;
+			node.top = top + compactBits(code >> 1) * side;
+			node.size = side;
+			node.children = childOffset + 4 * code;
+			node.first = nodes[node.children].first;
+			node.count = 0;
+			for (int child = 0; child < 4; ++child)
+				node.count += nodes[node.children + child].count;
+			sum(node, &nodes[node.children]);
+		}
+	}
+}
+
+void
+QuadTree::
+bound(const float* x, const float* y, int count, ThreadPool* threadPool)
+{
+	int slices = threadPool ? std::max(std::min(threadPool->getThreadCount(), count / MIN_SLICE), 1) : 1;
+	if ((int)sliceBounds.size() < slices * 4)
+		sliceBounds.resize(slices * 4);
+	float* bounds = sliceBounds.data();
+	auto boundSlice = [x, y, count, slices, bounds](int slice)
+	{
+		int begin = (int)((long long)count * slice / slices);
+		int end = (int)((long long)count * (slice + 1) / slices);
+		float minX = x[begin], minY = y[begin], maxX = x[begin], maxY = y[begin];
+		for (int i = begin + 1; i < end; ++i)
+		{
+			minX = std::min(minX, x[i]);
+			maxX = std::max(maxX, x[i]);
+			minY = std::min(minY, y[i]);
+			maxY = std::max(maxY, y[i]);
+		}
+		bounds[slice * 4] = minX;
+		bounds[slice * 4 + 1] = minY;
+		bounds[slice * 4 + 2] = maxX;
+		bounds[slice * 4 + 3] = maxY;
+	};
+	if (threadPool)
+		threadPool->run(slices, boundSlice);
+	else
+		boundSlice(0);
+
+	float minX = bounds[0], minY = bounds[1], maxX = bounds[2], maxY = bounds[3];
+	for (int slice = 1; slice < slices; ++slice)
+	{
+		minX = std::min(minX, bounds[slice * 4]);
+		minY = std::min(minY, bounds[slice * 4 + 1]);
+		maxX = std::max(maxX, bounds[slice * 4 + 2]);
+		maxY = std::max(maxY, bounds[slice * 4 + 3]);
+	}
+
+	// square, and a little larger so the far edges fall inside
+	left = minX;
+	top = minY;
+	size = std::max(std::max(maxX - minX, maxY - minY) * 1.0001f, 1.0f);
+}
+
+void
+QuadTree::
+countSlice(const float* x, const float* y, int count, int slice, int slices)
+{
+	int begin = (int)((long long)count * slice / slices);
+	int end = (int)((long long)count * (slice + 1) / slices);
+	int* counts = sliceBuckets.data() + slice * BUCKETS;
+	for (int i = begin; i < end; ++i)
+	{
+		int bucket = getBucket(x[i], y[i]);
+		pointBuckets[i] = bucket;
+		++counts[bucket];
+	}
+}
+
+void
+QuadTree::
+scatterSlice(const float* x, const float* y, const float* mass, int count, int slice, int slices)
+{
+	int begin = (int)((long long)count * slice / slices);
+	int end = (int)((long long)count * (slice + 1) / slices);
+	int* offsets = sliceBuckets.data() + slice * BUCKETS;
+	for (int i = begin; i < end; ++i)
+	{
+		Point& point = points[offsets[pointBuckets[i]]++];
+		point.x = x[i];
+		point.y = y[i];
+		point.mass = mass[i];
+		point.index = i;
+	}
+}
+
+void
+QuadTree::
+buildBucket(int bucket)
+{
+	const int SIDE = 1 << TOP_DEPTH;
+	float side = size / SIDE;
+
+	std::vector<Node>& tree = bucketNodes[bucket];
+	tree.clear();
+	bucketLeaves[bucket].clear();
+
+	Node root;
+	root.left = left + compactBits(bucket) * side;
+	root.top = top + compactBits(bucket >> 1) * side;
+	root.size = side;
+	root.children = -1;
+	root.first = bucketStart[bucket];
+	root.count = bucketStart[bucket + 1] - bucketStart[bucket];
+	tree.push_back(root);
+	split(tree, bucketLeaves[bucket], 0, TOP_DEPTH);
+}
+
+void
+QuadTree::
+split(std::vector<Node>& tree, std::vector<int>& treeLeaves, int node, int depth)
+{
+	Node parent = tree[node];
+	Point* begin = points.data() + parent.first;
+	Point* end = begin + parent.count;
+	if (parent.count <= LEAF_SIZE || depth >= MAX_DEPTH)
+	{
+		Node& leaf = tree[node];
+		leaf.mass = 0;
+		float x = 0;
+		float y = 0;
+		for (Point* point = begin; point != end; ++point)
+		{
+			leaf.mass += point->mass;
+			x += point->x * point->mass;
+			y += point->y * point->mass;
+		}
+		leaf.x = leaf.mass > 0 ? x / leaf.mass : parent.left + parent.size / 2;
+		leaf.y = leaf.mass > 0 ? y / leaf.mass : parent.top + parent.size / 2;
+		if (parent.count > 0)
+			treeLeaves.push_back(node);
+		return;
+	}
+
+	// top and bottom halves, then left and right in each
+	float half = parent.size / 2;
+	float middleX = parent.left + half;
+	float middleY = parent.top + half;
+	Point* middle = std::partition(begin, end, [=](const Point& point) { return point.y < middleY; });
+	Point* topMiddle = std::partition(begin, middle, [=](const Point& point) { return point.x < middleX; });
+	Point* bottomMiddle = std::partition(middle, end, [=](const Point& point) { return point.x < middleX; });
+	Point* bounds[5] = { begin, topMiddle, middle, bottomMiddle, end };
+
+	int children = (int)tree.size();
+	tree.resize(children + 4);
+	tree[node].children = children;
+	for (int child = 0; child < 4; ++child)
+	{
+		Node& quadrant = tree[children + child];
+		quadrant.left = parent.left + (child & 1) * half;
+		quadrant.top = parent.top + (child >> 1) * half;
+		quadrant.size = half;
+		quadrant.children = -1;
+		quadrant.first = (int)(bounds[child] - points.data());
+		quadrant.count = (int)(bounds[child + 1] - bounds[child]);
+	}
+
+	for (int child = 0; child < 4; ++child)
+		split(tree, treeLeaves, children + child, depth + 1);
+	sum(tree[node], &tree[children]);
+}
+
+void
+QuadTree::
+sum(Node& node, const Node* children)
+{
+	float x = 0;
+	float y = 0;
+	node.mass = 0;
+	for (int child = 0; child < 4; ++child)
+	{
+		node.mass += children[child].mass;
+		x += children[child].x * children[child].mass;
+		y += children[child].y * children[child].mass;
+	}
+	node.x = node.mass > 0 ? x / node.mass : node.left + node.size / 2;
+	node.y = node.mass > 0 ? y / node.mass : node.top + node.size / 2;
+}
+
+void
+QuadTree::
+interactions(int leaf, float theta, std::vector<Point>& sources) const
+{
+	// Nodes that hold the leaf are at distance 0, so always opened.
+	sources.clear();
+	if (nodes.empty())
+		return;
+
+	const Node& target = nodes[leaf];
+	float right = target.left + target.size;
+	float bottom = target.top + target.size;
+	float theta2 = theta * theta;
+	int stack[4 * MAX_DEPTH];
+	int depth = 0;
+	stack[depth++] = 0;
+	while (depth > 0)
+	{
+		const Node& node = nodes[stack[--depth]];
+		if (node.mass <= 0)
+			continue;
+
+		if (node.children < 0)
+		{
+			sources.insert(sources.end(), points.begin() + node.first, points.begin() + node.first + node.count);
+			continue;
+		}
+
+		float dx = std::max(std::max(target.left - node.x, node.x - right), 0.0f);
+		float dy = std::max(std::max(target.top - node.y, node.y - bottom), 0.0f);
+		if (node.size * node.size < theta2 * (dx * dx + dy * dy))
+		{
+			Point point;
+			point.x = node.x;
+			point.y = node.y;
+			point.mass = node.mass;
+			point.index = -1;
+			sources.push_back(point);
+			continue;
+		}
+
+		for (int child = 0; child < 4; ++child)
+			stack[depth++] = node.children + child;
+	}
+}
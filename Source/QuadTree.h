@@ -0,0 +1,104 @@
+#pragma once
+
+#include <vector>
+
+#include "ThreadPool.h"
+
+// Barnes-Hut quadtree over weighted points, rebuilt from scratch every step.
+// The top TOP_DEPTH levels are a fixed grid of buckets in Morton order: the
+// points are counting sorted into the buckets in parallel, every bucket's
+// subtree is then built by its own task, and the few nodes above them are
+// summed up last. Every node has the total mass and the center of mass of
+// the points under it, so far away groups of points can be treated as one.
+class QuadTree
+{
+public:
+	// Points a leaf holds before it is split
+	static const int LEAF_SIZE = 16;
+
+	// Levels of the bucket grid, 16x16 buckets
+	static const int TOP_DEPTH = 4;
+
+	// Deeper than this points are too close for float coordinates to split
+	static const int MAX_DEPTH = 24;
+
+	struct Point
+	{
+		float x;
+		float y;
+		float mass;
+		// index in the arrays the tree was built from
+		int index;
+	};
+
+	struct Node
+	{
+		// center of mass and total mass
+		float x;
+		float y;
+		float mass;
+		// top left corner and side
+		float left;
+		float top;
+		float size;
+		// first of four children, top left, top right, bottom left and
+		// bottom right, or -1 for a leaf
+		int children;
+		// points under the node
+		int first;
+		int count;
+	};
+
+private:
+	static const int BUCKETS = 1 << (2 * TOP_DEPTH);
+	static const int TOP_NODES = (BUCKETS - 1) / 3;
+
+	std::vector<Node> nodes;
+	std::vector<Point> points;
+	std::vector<int> leaves;
+	float left;
+	float top;
+	float size;
+
+	// counting sort into the buckets, per slice of the input
+	std::vector<int> pointBuckets;
+	std::vector<int> sliceBuckets;
+	int bucketStart[BUCKETS + 1];
+	// bounds of every slice of the input
+	std::vector<float> sliceBounds;
+	// every bucket's subtree, root first, and its leaves, before they are
+	// copied over
+	std::vector<std::vector<Node> > bucketNodes;
+	std::vector<std::vector<int> > bucketLeaves;
+	// where the rest of every bucket's subtree goes, less one
+	int bucketOffsets[BUCKETS];
+
+	void bound(const float* x, const float* y, int count, ThreadPool* threadPool);
+	void countSlice(const float* x, const float* y, int count, int slice, int slices);
+	void scatterSlice(const float* x, const float* y, const float* mass, int count, int slice, int slices);
+	void buildBucket(int bucket);
+	void split(std::vector<Node>& tree, std::vector<int>& treeLeaves, int node, int depth);
+	void sum(Node& node, const Node* children);
+	int getBucket(float x, float y) const;
+
+public:
+	QuadTree();
+
+	// Builds the tree over count points of the given positions and masses;
+	// masses must not be negative
+	void build(const float* x, const float* y, const float* mass, int count, ThreadPool* threadPool = nullptr);
+	void clear();
+
+	// Nodes, the root first, the points sorted by leaf and the leaves that
+	// hold any, in the order of their points
+	const std::vector<Node>& getNodes() const { return nodes; }
+	const std::vector<Point>& getPoints() const { return points; }
+	const std::vector<int>& getLeaves() const { return leaves; }
+
+	// Collects what the points of a leaf feel from the whole tree: nodes
+	// seen from the leaf under less than the opening angle theta, their side
+	// over their distance to the nearest point of the leaf, as one point at
+	// their center of mass, and the points of the leaves that are too close,
+	// its own included, one by one. 0 collects every point.
+	void interactions(int leaf, float theta, std::vector<Point>& sources) const;
+};
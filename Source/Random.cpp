@@ -0,0 +1,110 @@
+#include "Random.h"
+
+namespace
+{
+	uint64_t masterSeed = 0x853c49e6748fea9bull;
+
+	uint64_t
+	splitmix64(uint64_t& x)
+	{
+		uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+
+	inline uint32_t
+	rotl(uint32_t x, int k)
+	{
+		return (x << k) | (x >> (32 - k));
+	}
+
+	// 24 random bits mapped to [0, 1], both ends included
+	const float UNIT = 1.0f / 16777215.0f;
+}
+
+Random::
+Random(uint64_t stream)
+{
+	seed(masterSeed, stream);
+}
+
+Random::
+Random(uint64_t seed, uint64_t stream)
+{
+	this->seed(seed, stream);
+}
+
+void
+Random::
+setMasterSeed(uint64_t value)
+{
+	masterSeed = value;
+}
+
+uint64_t
+Random::
+getMasterSeed()
+{
+	return masterSeed;
+}
+
+void
+Random::
+seed(uint64_t seed, uint64_t stream)
+{
+	// mix the stream id into the seed so neighbouring streams are unrelated
+	uint64_t mixer = stream;
+	uint64_t x = seed ^ splitmix64(mixer);
+	for (int i = 0; i < 4; i += 2)
+	{
+		uint64_t value = splitmix64(x);
+		state[i] = uint32_t(value);
+		state[i + 1] = uint32_t(value >> 32);
+	}
+
+	// the all-zero state is the only one xoshiro never leaves
+	if (!(state[0] | state[1] | state[2] | state[3]))
+		state[0] = 1;
+}
+
+uint32_t
+Random::
+next()
+{
+	uint32_t result = state[0] + state[3];
+	uint32_t t = state[1] << 9;
+
+	state[2] ^= state[0];
+	state[3] ^= state[1];
+	state[1] ^= state[2];
+	state[0] ^= state[3];
+	state[2] ^= t;
+	state[3] = rotl(state[3], 11);
+
+	return result;
+}
+
+float
+Random::
+nextFloat()
+{
+	// the upper bits of xoshiro128+ are the strongest
+	return (next() >> 8) * UNIT;
+}
+
+float
+Random::
+range(float min, float max)
+{
+	return min + nextFloat() * (max - min);
+}
+
+void
+Random::
+fill(float* out, int count, float min, float max)
+{
+	float scale = (max - min) * UNIT;
+	for (int i = 0; i < count; ++i)
+		out[i] = min + (next() >> 8) * scale;
+}
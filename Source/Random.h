@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+// Small, fast xoshiro128+ generator with float output. Every instance is an
+// independent stream derived from the process-wide master seed and a stream
+// id, so each emitter or worker thread can draw numbers without sharing
+// state, and a run can be reproduced by reusing the master seed.
+class Random
+{
+	uint32_t state[4];
+
+public:
+	// Stream of the given id under the current master seed
+	Random(uint64_t stream = 0);
+	Random(uint64_t seed, uint64_t stream);
+
+	static void setMasterSeed(uint64_t value);
+	static uint64_t getMasterSeed();
+
+	void seed(uint64_t seed, uint64_t stream);
+
+	uint32_t next();
+
+	// Uniform value in [0, 1]
+	float nextFloat();
+
+	// Uniform value in [min, max]
+	float range(float min, float max);
+
+	// Fills count values uniformly distributed in [min, max]
+	void fill(float* out, int count, float min, float max);
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "SDL/SDL.h"
+
+#include "ParticleVertex.h"
+
+// Draws particle vertex streams as round, alpha-blended points, in screen
+// coordinates with y pointing down. Implemented with OpenGL by
+// ParticleRenderer and on the CPU by SoftwareRenderer.
+class Renderer
+{
+public:
+	virtual ~Renderer() {}
+
+	// Layout emitters should write their vertex streams in
+	virtual VertexFormat getVertexFormat() = 0;
+
+	virtual void draw(const ParticleVertex* vertices, int count, float pointSize) = 0;
+	virtual void draw(const ParticleSprite* vertices, int count, float pointSize, const SDL_Color& color, bool fade) = 0;
+	virtual void draw(const PackedParticle* vertices, int count, float pointSize, const SDL_Color* palette, int paletteSize, int width, int height) = 0;
+};
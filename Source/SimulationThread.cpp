@@ -0,0 +1,170 @@
+#include "SimulationThread.h"
+
+#include <chrono>
+
+#include "SDL/SDL.h"
+
+SimulationThread::
+SimulationThread(ParticleSystem* system, float stepTime)
+: system(system),
+  stepTime(stepTime),
+  scheduler(1, MAX_CATCH_UP_STEPS),
+  running(false)
+{
+}
+
+SimulationThread::
+~SimulationThread()
+{
+	stop();
+}
+
+void
+SimulationThread::
+start()
+{
+	if (running)
+		return;
+
+	running = true;
+	thread = std::thread(&SimulationThread::run, this);
+}
+
+void
+SimulationThread::
+stop()
+{
+	running = false;
+	if (thread.joinable())
+		thread.join();
+
+	// nobody else is left to apply them
+	commands.execute();
+}
+
+void
+SimulationThread::
+setStepTime(float value)
+{
+	stepTime = value;
+}
+
+float
+SimulationThread::
+getStepTime()
+{
+	return stepTime;
+}
+
+void
+SimulationThread::
+setMaxSteps(int value)
+{
+	post([=] { scheduler.setMaxSteps(value); });
+}
+
+void
+SimulationThread::
+setOverloadPolicy(StepScheduler::Policy value)
+{
+	post([=] { scheduler.setPolicy(value); });
+}
+
+void
+SimulationThread::
+setThrottling(bool value)
+{
+	post([=] { scheduler.setThrottling(value); });
+}
+
+void
+SimulationThread::
+post(const std::function<void()>& command)
+{
+	commands.post(command);
+}
+
+bool
+SimulationThread::
+update()
+{
+	return snapshots.update();
+}
+
+const Snapshot&
+SimulationThread::
+getSnapshot()
+{
+	return snapshots.getFront();
+}
+
+void
+SimulationThread::
+run()
+{
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+	scheduler.reset(SDL_GetPerformanceCounter());
+
+	int steps = 0;
+	int rateSteps = 0;
+	Uint64 rateStart = scheduler.getNext();
+	float stepRate = 0;
+
+	while (running)
+	{
+		float stepTime = this->stepTime;
+		scheduler.setStepTicks(Uint64(stepTime * frequency));
+
+		Uint64 now = SDL_GetPerformanceCounter();
+		int due = scheduler.schedule(now);
+		if (due == 0)
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds((scheduler.getNext() - now) * 1000000 / frequency));
+			continue;
+		}
+
+		float updateTime = 0;
+		int allocations = 0;
+		for (int i = 0; i < due; ++i)
+		{
+			commands.execute();
+			system->setRateScale(scheduler.getRateScale());
+
+			int allocated = system->getAllocationCount();
+			Uint64 start = SDL_GetPerformanceCounter();
+			system->update(stepTime);
+			Uint64 cost = SDL_GetPerformanceCounter() - start;
+			updateTime = float(cost) * 1000 / frequency;
+			allocations += system->getAllocationCount() - allocated;
+
+			scheduler.stepped(cost);
+			++steps;
+			++rateSteps;
+		}
+		scheduler.finish();
+
+		now = SDL_GetPerformanceCounter();
+		if (now - rateStart >= 2 * frequency)
+		{
+			stepRate = float(rateSteps) * frequency / (now - rateStart);
+			rateSteps = 0;
+			rateStart = now;
+		}
+
+		const StepScheduler::Report& report = scheduler.getReport();
+		Snapshot& snapshot = snapshots.getBack();
+		system->snapshot(snapshot);
+		snapshot.step = steps;
+		snapshot.particleCount = system->getParticleCount();
+		snapshot.updateTime = updateTime;
+		snapshot.allocations = allocations;
+		snapshot.stepRate = stepRate;
+		snapshot.stepsRun = report.run;
+		snapshot.stepsSkipped = report.skipped;
+		snapshot.stepsThrottled = report.throttled;
+		snapshot.rateScale = scheduler.getRateScale();
+		snapshot.time = scheduler.getNext() - scheduler.getStepTicks();
+		snapshot.stepTicks = scheduler.getStepTicks();
+		snapshots.publish();
+	}
+}
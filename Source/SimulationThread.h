@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+#include "CommandQueue.h"
+#include "ParticleSystem.h"
+#include "Snapshot.h"
+#include "StepScheduler.h"
+#include "TripleBuffer.h"
+
+// Steps a particle system at a fixed rate on a thread of its own, so
+// rendering and simulation no longer slow each other down. After each
+// batch of steps a Snapshot is published through a triple buffer for the
+// render thread; changes go the other way through a command queue and are
+// applied between steps. While the thread runs, the system, its bodies and
+// its emitters must only be touched from posted commands.
+class SimulationThread
+{
+	ParticleSystem* system;
+	std::atomic<float> stepTime;
+	StepScheduler scheduler;
+	CommandQueue commands;
+	TripleBuffer<Snapshot> snapshots;
+	std::thread thread;
+	std::atomic<bool> running;
+
+	void run();
+
+public:
+	// Default for the number of steps taken in a row to catch up after a
+	// stall, see StepScheduler
+	static const int MAX_CATCH_UP_STEPS = 5;
+
+	SimulationThread(ParticleSystem* system, float stepTime);
+	~SimulationThread();
+
+	void start();
+	void stop();
+
+	// Length of a step in seconds, picked up by the next batch of steps
+	void setStepTime(float value);
+	float getStepTime();
+
+	// Step budget and overload handling, applied before the next step
+	void setMaxSteps(int value);
+	void setOverloadPolicy(StepScheduler::Policy value);
+	void setThrottling(bool value);
+
+	// Runs command on the simulation thread before the next step
+	void post(const std::function<void()>& command);
+
+	// Render thread side: takes the latest snapshot if a new one was
+	// published, and returns whether it did
+	bool update();
+	const Snapshot& getSnapshot();
+};
@@ -0,0 +1,124 @@
+#include "Snapshot.h"
+
+ParticleSnapshot::
+ParticleSnapshot()
+: width(0),
+  height(0)
+{
+}
+
+void
+ParticleSnapshot::
+render(Renderer& renderer) const
+{
+	draw(renderer, vertices, groups, palette, width, height);
+}
+
+void
+ParticleSnapshot::
+render(Renderer& renderer, float alpha, VertexStream& scratch) const
+{
+	if (!vertices.hasMotion() || alpha >= 1)
+	{
+		render(renderer);
+		return;
+	}
+
+	vertices.interpolate(alpha, width, height, scratch);
+	draw(renderer, scratch, groups, palette, width, height);
+}
+
+void
+ParticleSnapshot::
+draw(Renderer& renderer, const VertexStream& vertices, const std::vector<VertexGroup>& groups, const std::vector<SDL_Color>& palette, int width, int height)
+{
+	for (const VertexGroup& group : groups)
+	{
+		if (group.count <= 0)
+			continue;
+
+		switch (vertices.getFormat())
+		{
+		case SpriteVertex:
+			renderer.draw(static_cast<const ParticleSprite*>(vertices.at(group.first)), group.count, group.particleSize, group.color, group.fade);
+			break;
+
+		case PackedVertex:
+			renderer.draw(static_cast<const PackedParticle*>(vertices.at(group.first)), group.count, group.particleSize, palette.data(), (int)palette.size(), width, height);
+			break;
+
+		default:
+			renderer.draw(static_cast<const ParticleVertex*>(vertices.at(group.first)), group.count, group.particleSize);
+			break;
+		}
+	}
+}
+
+void
+BodySnapshot::
+draw(Renderer& renderer, const std::vector<BodySnapshot>& bodies, float alpha)
+{
+	// batched on the stack, so drawing allocates nothing
+	const int BATCH_SIZE = 64;
+	ParticleVertex vertices[BATCH_SIZE];
+	int count = 0;
+	for (size_t i = 0; i < bodies.size(); ++i)
+	{
+		const BodySnapshot& body = bodies[i];
+		float x = body.previousPosition.x + (body.position.x - body.previousPosition.x) * alpha;
+		float y = body.previousPosition.y + (body.position.y - body.previousPosition.y) * alpha;
+		ParticleVertex vertex = { x, y, body.color.r / 255.f, body.color.g / 255.f, body.color.b / 255.f, body.color.a / 255.f };
+		vertices[count++] = vertex;
+
+		if (count == BATCH_SIZE || i + 1 == bodies.size() || bodies[i + 1].size != body.size)
+		{
+			renderer.draw(vertices, count, body.size);
+			count = 0;
+		}
+	}
+}
+
+Snapshot::
+Snapshot()
+: step(0),
+  particleCount(0),
+  updateTime(0),
+  allocations(0),
+  stepRate(0),
+  stepsRun(0),
+  stepsSkipped(0),
+  stepsThrottled(0),
+  rateScale(1),
+  time(0),
+  stepTicks(0)
+{
+}
+
+float
+Snapshot::
+getAlpha(Uint64 now) const
+{
+	if (stepTicks == 0 || now >= time + stepTicks)
+		return 1;
+
+	if (now <= time)
+		return 0;
+
+	return float(now - time) / stepTicks;
+}
+
+void
+Snapshot::
+render(Renderer& renderer) const
+{
+	BodySnapshot::draw(renderer, bodies);
+	particles.render(renderer);
+}
+
+void
+Snapshot::
+render(Renderer& renderer, float alpha, VertexStream& scratch) const
+{
+	BodySnapshot::draw(renderer, bodies, alpha);
+	particles.render(renderer, alpha, scratch);
+}
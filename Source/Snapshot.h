@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+
+#include "SDL/SDL.h"
+
+#include "Renderer.h"
+#include "Vector2.h"
+#include "VertexStream.h"
+
+// A run of vertices in a stream that are drawn together, with the settings
+// they are drawn with. Sprites take their color and fade from the group;
+// the other formats carry their own.
+struct VertexGroup
+{
+	int first;
+	int count;
+	float particleSize;
+	SDL_Color color;
+	bool fade;
+};
+
+// What the renderer needs from a particle system: its vertex stream, sorted
+// into groups, and the palette packed vertices refer to.
+struct ParticleSnapshot
+{
+	VertexStream vertices;
+	std::vector<VertexGroup> groups;
+	std::vector<SDL_Color> palette;
+	int width;
+	int height;
+
+	ParticleSnapshot();
+
+	void render(Renderer& renderer) const;
+
+	// Draws the particles a fraction alpha of the way from their previous
+	// to their current positions, going through scratch when the stream
+	// has motion
+	void render(Renderer& renderer, float alpha, VertexStream& scratch) const;
+
+	// Draws every group of a stream, one draw call each
+	static void draw(Renderer& renderer, const VertexStream& vertices, const std::vector<VertexGroup>& groups, const std::vector<SDL_Color>& palette, int width, int height);
+};
+
+struct BodySnapshot
+{
+	Vector2 position;
+	// where the body was on the step before last
+	Vector2 previousPosition;
+	float size;
+	SDL_Color color;
+
+	// Draws the bodies as dots, a fraction alpha of the way from their
+	// previous to their current positions, batching runs of equal size
+	static void draw(Renderer& renderer, const std::vector<BodySnapshot>& bodies, float alpha = 1);
+};
+
+// An immutable copy of the simulation after a step, published by the
+// simulation thread for the render thread to draw, with the statistics
+// the settings window shows.
+struct Snapshot
+{
+	ParticleSnapshot particles;
+	std::vector<BodySnapshot> bodies;
+
+	// number of steps taken so far
+	int step;
+	int particleCount;
+	// duration of the last step, in milliseconds
+	float updateTime;
+	// heap allocations made by the last step
+	int allocations;
+	// steps per second, measured over the last couple of seconds
+	float stepRate;
+	// steps the last batch ran, gave up on to stay within its budget, and
+	// ran with throttled spawns
+	int stepsRun;
+	int stepsSkipped;
+	int stepsThrottled;
+	// factor spawn rates are scaled by to shed load
+	float rateScale;
+	// performance counter time the last step stands for, and the length
+	// of a step in counter ticks
+	Uint64 time;
+	Uint64 stepTicks;
+
+	Snapshot();
+
+	// How far the render thread is at counter time now between the step
+	// before last and the last one, from 0 to 1
+	float getAlpha(Uint64 now) const;
+
+	void render(Renderer& renderer) const;
+	void render(Renderer& renderer, float alpha, VertexStream& scratch) const;
+};
@@ -0,0 +1,296 @@
+#include "SoftwareRenderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "Extensions.h"
+
+namespace
+{
+	// Smallest number of points worth binning on a thread of its own
+	const int MIN_SLICE_SIZE = 4096;
+
+	// Pixels a point can touch: the disc plus the half-pixel antialiased edge
+	void
+	bounds(const ParticleVertex& vertex, float radius, int& left, int& top, int& right, int& bottom)
+	{
+		left = (int)std::floor(vertex.x - radius - 0.5f);
+		top = (int)std::floor(vertex.y - radius - 0.5f);
+		right = left + SoftwareRenderer::getStampSize(radius);
+		bottom = top + SoftwareRenderer::getStampSize(radius);
+	}
+
+	// Offset of the point from the corner of its stamp, in stamp steps
+	int
+	step(float position, int corner, float radius)
+	{
+		int result = (int)((position - corner - radius - 0.5f) * SoftwareRenderer::STAMP_STEPS);
+		return result < 0 ? 0 : result >= SoftwareRenderer::STAMP_STEPS ? SoftwareRenderer::STAMP_STEPS - 1 : result;
+	}
+}
+
+SoftwareRenderer::
+SoftwareRenderer(int width, int height, ThreadPool* threadPool)
+: width(width),
+  height(height),
+  tilesX((width + TILE_SIZE - 1) / TILE_SIZE),
+  tilesY((height + TILE_SIZE - 1) / TILE_SIZE),
+  threadPool(threadPool),
+  pixels((size_t)width * height * 4, 0),
+  stamps(nullptr)
+{
+}
+
+int
+SoftwareRenderer::
+getStampSize(float radius)
+{
+	return (int)std::ceil(2 * radius + 1) + 1;
+}
+
+const unsigned short*
+SoftwareRenderer::
+getStamps(float radius)
+{
+	// Coverage, out of 256, of the pixels around a point for each sub-pixel
+	// offset; it falls off over the last pixel of the radius. Bodies and
+	// particles are drawn at different sizes every frame, so every size's
+	// stamps are kept, up to a few of them.
+	std::map<float, std::vector<unsigned short> >::iterator found = stampSets.find(radius);
+	if (found != stampSets.end())
+		return found->second.data();
+
+	if ((int)stampSets.size() >= MAX_STAMP_SETS)
+		stampSets.clear();
+
+	int size = getStampSize(radius);
+	std::vector<unsigned short>& set = stampSets[radius];
+	set.resize((size_t)STAMP_STEPS * STAMP_STEPS * size * size);
+	for (int sy = 0; sy < STAMP_STEPS; ++sy)
+		for (int sx = 0; sx < STAMP_STEPS; ++sx)
+		{
+			// center of the point relative to the stamp corner
+			float x = radius + 0.5f + (sx + 0.5f) / STAMP_STEPS;
+			float y = radius + 0.5f + (sy + 0.5f) / STAMP_STEPS;
+			unsigned short* stamp = &set[(size_t)(sy * STAMP_STEPS + sx) * size * size];
+			for (int row = 0; row < size; ++row)
+				for (int column = 0; column < size; ++column)
+				{
+					float dx = column + 0.5f - x;
+					float dy = row + 0.5f - y;
+					float coverage = std::min(std::max(radius + 0.5f - std::sqrt(dx * dx + dy * dy), 0.0f), 1.0f);
+					stamp[row * size + column] = (unsigned short)(coverage * 256 + 0.5f);
+				}
+		}
+
+	return set.data();
+}
+
+void
+SoftwareRenderer::
+setThreadPool(ThreadPool* value)
+{
+	threadPool = value;
+}
+
+ThreadPool*
+SoftwareRenderer::
+getThreadPool()
+{
+	return threadPool;
+}
+
+int
+SoftwareRenderer::
+getWidth()
+{
+	return width;
+}
+
+int
+SoftwareRenderer::
+getHeight()
+{
+	return height;
+}
+
+const unsigned char*
+SoftwareRenderer::
+getPixels()
+{
+	return pixels.data();
+}
+
+void
+SoftwareRenderer::
+clear(const SDL_Color& color)
+{
+	unsigned char rgba[4] = { color.r, color.g, color.b, color.a };
+	Uint32 value;
+	memcpy(&value, rgba, 4);
+	std::fill(reinterpret_cast<Uint32*>(pixels.data()), reinterpret_cast<Uint32*>(pixels.data() + pixels.size()), value);
+}
+
+VertexFormat
+SoftwareRenderer::
+getVertexFormat()
+{
+	return ColoredVertex;
+}
+
+void
+SoftwareRenderer::
+draw(const ParticleVertex* vertices, int count, float pointSize)
+{
+	if (count <= 0)
+		return;
+
+	float radius = pointSize / 2;
+	stamps = getStamps(radius);
+
+	int tiles = tilesX * tilesY;
+	int threads = threadPool ? threadPool->getThreadCount() : 1;
+	int slices = std::max(1, std::min(threads, count / MIN_SLICE_SIZE));
+	if ((int)bins.size() < slices * tiles)
+		bins.resize(slices * tiles);
+
+	int sliceSize = (count + slices - 1) / slices;
+	auto binSlice = [&](int slice)
+	{
+		int begin = slice * sliceSize;
+		int end = std::min(begin + sliceSize, count);
+		bin(vertices, begin, end, radius, &bins[slice * tiles]);
+	};
+	auto rasterizeTile = [&](int tile) { rasterize(vertices, tile, radius, slices); };
+
+	if (threadPool)
+	{
+		threadPool->run(slices, binSlice);
+		threadPool->run(tiles, rasterizeTile);
+	}
+	else
+	{
+		binSlice(0);
+		for (int tile = 0; tile < tiles; ++tile)
+			rasterizeTile(tile);
+	}
+}
+
+void
+SoftwareRenderer::
+draw(const ParticleSprite* vertices, int count, float pointSize, const SDL_Color& color, bool fade)
+{
+	decoded.resize(std::max(count, 0));
+	for (int i = 0; i < count; ++i)
+	{
+		float age = vertices[i].age;
+		ParticleVertex& vertex = decoded[i];
+		vertex.x = vertices[i].x;
+		vertex.y = vertices[i].y;
+		vertex.r = color.r / 255.f;
+		vertex.g = color.g / 255.f;
+		vertex.b = color.b / 255.f;
+		vertex.a = (fade ? 1 - std::clamp(age / (1 - age), 0.0, 1.0) : 1) * color.a / 255.f;
+	}
+
+	draw(decoded.data(), count, pointSize);
+}
+
+void
+SoftwareRenderer::
+draw(const PackedParticle* vertices, int count, float pointSize, const SDL_Color* palette, int paletteSize, int width, int height)
+{
+	decoded.resize(std::max(count, 0));
+	for (int i = 0; i < count; ++i)
+	{
+		const PackedParticle& packed = vertices[i];
+		const SDL_Color& color = palette[packed.color < paletteSize ? packed.color : 0];
+		float age = packed.age / 255.f;
+		ParticleVertex& vertex = decoded[i];
+		vertex.x = packed.x / 65535.f * width;
+		vertex.y = packed.y / 65535.f * height;
+		vertex.r = color.r / 255.f;
+		vertex.g = color.g / 255.f;
+		vertex.b = color.b / 255.f;
+		vertex.a = (packed.fade ? 1 - std::clamp(age / (1 - age), 0.0, 1.0) : 1) * color.a / 255.f;
+	}
+
+	draw(decoded.data(), count, pointSize);
+}
+
+void
+SoftwareRenderer::
+bin(const ParticleVertex* vertices, int begin, int end, float radius, std::vector<int>* bins)
+{
+	for (int tile = 0; tile < tilesX * tilesY; ++tile)
+		bins[tile].clear();
+
+	for (int i = begin; i < end; ++i)
+	{
+		int left, top, right, bottom;
+		bounds(vertices[i], radius, left, top, right, bottom);
+		if (right < 0 || bottom < 0 || left >= width || top >= height)
+			continue;
+
+		int tileLeft = std::max(left, 0) / TILE_SIZE;
+		int tileTop = std::max(top, 0) / TILE_SIZE;
+		int tileRight = std::min(right, width - 1) / TILE_SIZE;
+		int tileBottom = std::min(bottom, height - 1) / TILE_SIZE;
+		for (int ty = tileTop; ty <= tileBottom; ++ty)
+			for (int tx = tileLeft; tx <= tileRight; ++tx)
+				bins[ty * tilesX + tx].push_back(i);
+	}
+}
+
+void
+SoftwareRenderer::
+rasterize(const ParticleVertex* vertices, int tile, float radius, int slices)
+{
+	int tileLeft = (tile % tilesX) * TILE_SIZE;
+	int tileTop = (tile / tilesX) * TILE_SIZE;
+	int tileRight = std::min(tileLeft + TILE_SIZE, width);
+	int tileBottom = std::min(tileTop + TILE_SIZE, height);
+	int tiles = tilesX * tilesY;
+
+	int size = getStampSize(radius);
+
+	for (int slice = 0; slice < slices; ++slice)
+	{
+		const std::vector<int>& points = bins[slice * tiles + tile];
+		for (std::vector<int>::const_iterator it = points.begin(); it != points.end(); ++it)
+		{
+			const ParticleVertex& vertex = vertices[*it];
+			int left, top, right, bottom;
+			bounds(vertex, radius, left, top, right, bottom);
+			const unsigned short* stamp = &stamps[(size_t)(step(vertex.y, top, radius) * STAMP_STEPS + step(vertex.x, left, radius)) * size * size];
+			int columns = std::max(left, tileLeft) - left;
+			int rows = std::max(top, tileTop) - top;
+			right = std::min(right, tileRight);
+			bottom = std::min(bottom, tileBottom);
+
+			// 8-bit fixed point blending, alpha out of 256
+			int opacity = (int)(vertex.a * 256 + 0.5f);
+			int r = (int)(vertex.r * 255 + 0.5f);
+			int g = (int)(vertex.g * 255 + 0.5f);
+			int b = (int)(vertex.b * 255 + 0.5f);
+			for (int py = top + rows; py < bottom; ++py)
+			{
+				const unsigned short* coverage = stamp + (py - top) * size + columns;
+				unsigned char* pixel = &pixels[((size_t)py * width + left + columns) * 4];
+				for (int px = left + columns; px < right; ++px, ++coverage, pixel += 4)
+				{
+					int alpha = (opacity * *coverage + 128) >> 8;
+					if (!alpha)
+						continue;
+
+					int keep = 256 - alpha;
+					pixel[0] = (unsigned char)((r * alpha + pixel[0] * keep + 128) >> 8);
+					pixel[1] = (unsigned char)((g * alpha + pixel[1] * keep + 128) >> 8);
+					pixel[2] = (unsigned char)((b * alpha + pixel[2] * keep + 128) >> 8);
+					pixel[3] = (unsigned char)((((alpha * alpha) >> 8) * 255 + pixel[3] * keep + 128) >> 8);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "SDL/SDL.h"
+
+#include "ParticleVertex.h"
+#include "Renderer.h"
+#include "ThreadPool.h"
+
+// Rasterizes particles on the CPU into an RGBA framebuffer, for machines
+// without a GPU or a display. Points are round with an antialiased edge and
+// blended with SRC_ALPHA / ONE_MINUS_SRC_ALPHA, like smooth GL points.
+//
+// Coverage comes from stamps precomputed for each eighth of a pixel of
+// offset, so blending a pixel costs a lookup and a few integer operations.
+// Each draw bins the points by screen tile, in slices of the vertex stream
+// spread across the thread pool, then blends every tile on its own thread.
+// Tiles replay their slices in order, so points are blended in draw order
+// however many threads run.
+class SoftwareRenderer : public Renderer
+{
+public:
+	// Width and height, in pixels, of a screen tile
+	static const int TILE_SIZE = 64;
+
+	// Sub-pixel positions per axis a point's coverage is precomputed for
+	static const int STAMP_STEPS = 8;
+
+	// Point sizes whose stamps are kept at once
+	static const int MAX_STAMP_SETS = 8;
+
+	// Width and height, in pixels, of the area a point of the given radius
+	// can cover
+	static int getStampSize(float radius);
+
+	SoftwareRenderer(int width, int height, ThreadPool* threadPool = nullptr);
+
+	void setThreadPool(ThreadPool* value);
+	ThreadPool* getThreadPool();
+
+	int getWidth();
+	int getHeight();
+
+	// RGBA, 4 bytes per pixel, top row first
+	const unsigned char* getPixels();
+
+	void clear(const SDL_Color& color);
+
+	VertexFormat getVertexFormat() override;
+
+	void draw(const ParticleVertex* vertices, int count, float pointSize) override;
+	void draw(const ParticleSprite* vertices, int count, float pointSize, const SDL_Color& color, bool fade) override;
+	void draw(const PackedParticle* vertices, int count, float pointSize, const SDL_Color* palette, int paletteSize, int width, int height) override;
+
+private:
+	SoftwareRenderer(const SoftwareRenderer&);
+	SoftwareRenderer& operator=(const SoftwareRenderer&);
+
+	const unsigned short* getStamps(float radius);
+	void bin(const ParticleVertex* vertices, int begin, int end, float radius, std::vector<int>* bins);
+	void rasterize(const ParticleVertex* vertices, int tile, float radius, int slices);
+
+	int width;
+	int height;
+	int tilesX;
+	int tilesY;
+	ThreadPool* threadPool;
+	std::vector<unsigned char> pixels;
+	// point indices per slice and tile, kept between draws
+	std::vector<std::vector<int> > bins;
+	// sprites and packed particles, expanded to colored vertices
+	std::vector<ParticleVertex> decoded;
+	// coverage of a point per sub-pixel offset, per radius, and the stamps
+	// of the current draw
+	std::map<float, std::vector<unsigned short> > stampSets;
+	const unsigned short* stamps;
+};
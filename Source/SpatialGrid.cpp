@@ -0,0 +1,215 @@
+#include "SpatialGrid.h"
+
+#include <cmath>
+
+SpatialGrid::
+SpatialGrid(float cellSize, int width, int height)
+: cellSize(std::max(cellSize, 1.0f)),
+  inverseCellSize(1 / std::max(cellSize, 1.0f)),
+  width(width),
+  height(height),
+  columns(1),
+  rows(1),
+  count(0),
+  includeOutside(true)
+{
+	resize();
+}
+
+void
+SpatialGrid::
+resize()
+{
+	columns = std::max((int)std::ceil(width * inverseCellSize), 1);
+	rows = std::max((int)std::ceil(height * inverseCellSize), 1);
+	cellStart.assign(columns * rows + 2, 0);
+	count = 0;
+}
+
+void
+SpatialGrid::
+setCellSize(float value)
+{
+	cellSize = std::max(value, 1.0f);
+	inverseCellSize = 1 / cellSize;
+	resize();
+}
+
+float
+SpatialGrid::
+getCellSize() const
+{
+	return cellSize;
+}
+
+void
+SpatialGrid::
+setBounds(int width, int height)
+{
+	this->width = width;
+	this->height = height;
+	resize();
+}
+
+void
+SpatialGrid::
+setIncludeOutside(bool value)
+{
+	includeOutside = value;
+	count = 0;
+	std::fill(cellStart.begin(), cellStart.end(), 0);
+}
+
+bool
+SpatialGrid::
+getIncludeOutside() const
+{
+	return includeOutside;
+}
+
+int
+SpatialGrid::
+getColumns() const
+{
+	return columns;
+}
+
+int
+SpatialGrid::
+getRows() const
+{
+	return rows;
+}
+
+int
+SpatialGrid::
+getCell(float x, float y) const
+{
+	return clampRow(y) * columns + clampColumn(x);
+}
+
+// Cell a particle is filed under, or the one past the last cell when it is
+// outside and left out
+int
+SpatialGrid::
+fileCell(float x, float y) const
+{
+	if (!includeOutside && !(x >= 0 && x < width && y >= 0 && y < height))
+		return columns * rows;
+
+	return getCell(x, y);
+}
+
+void
+SpatialGrid::
+build(const ParticleBuffer& particles, ThreadPool* threadPool)
+{
+	// Counting sort in three passes: every slice counts its particles per
+	// cell, a prefix sum over cells then slices turns the counts into the
+	// offset each slice starts writing a cell at, and every slice scatters
+	// its particles. Slices write disjoint ranges, and the order within a
+	// cell is the buffer order, whatever the number of threads. Particles
+	// left out go to one more bucket past the last cell. There is a slice
+	// per thread rather than per chunk, since every slice has a table the
+	// size of the grid, and small cells make for a lot of them.
+	const int CHUNK_SIZE = ParticleBuffer::CHUNK_SIZE;
+	int total = particles.size();
+	int chunks = (total + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	int slices = std::min(chunks, threadPool ? threadPool->getThreadCount() : 1);
+	int cells = columns * rows + 1;
+
+	if ((int)particleCells.size() < total)
+	{
+		particleCells.resize(particles.capacity());
+		sortedEntries.resize(particles.capacity());
+		entries.resize(particles.capacity());
+	}
+	sliceCells.assign((size_t)slices * cells, 0);
+
+	if (threadPool)
+		threadPool->run(slices, [this, &particles, slices](int slice) { countSlice(particles, slice, slices); });
+	else
+		for (int slice = 0; slice < slices; ++slice)
+			countSlice(particles, slice, slices);
+
+	int offset = 0;
+	for (int cell = 0; cell < cells; ++cell)
+	{
+		cellStart[cell] = offset;
+		for (int slice = 0; slice < slices; ++slice)
+		{
+			int& n = sliceCells[(size_t)slice * cells + cell];
+			int start = offset;
+			offset += n;
+			n = start;
+		}
+	}
+	cellStart[cells] = offset;
+	count = cellStart[cells - 1];
+
+	if (threadPool)
+		threadPool->run(slices, [this, &particles, slices](int slice) { scatterSlice(particles, slice, slices); });
+	else
+		for (int slice = 0; slice < slices; ++slice)
+			scatterSlice(particles, slice, slices);
+}
+
+void
+SpatialGrid::
+countSlice(const ParticleBuffer& particles, int slice, int slices)
+{
+	int chunks = (particles.size() + ParticleBuffer::CHUNK_SIZE - 1) / ParticleBuffer::CHUNK_SIZE;
+	int* counts = sliceCells.data() + (size_t)slice * (columns * rows + 1);
+	for (int index = slice * chunks / slices; index < (slice + 1) * chunks / slices; ++index)
+	{
+		const ParticleChunk& chunk = particles.getChunk(index);
+		int begin = index * ParticleBuffer::CHUNK_SIZE;
+		int size = std::min(ParticleBuffer::CHUNK_SIZE, particles.size() - begin);
+		int* cells = particleCells.data() + begin;
+		for (int i = 0; i < size; ++i)
+		{
+			int cell = fileCell(chunk.x[i], chunk.y[i]);
+			cells[i] = cell;
+			++counts[cell];
+		}
+	}
+}
+
+void
+SpatialGrid::
+scatterSlice(const ParticleBuffer& particles, int slice, int slices)
+{
+	int chunks = (particles.size() + ParticleBuffer::CHUNK_SIZE - 1) / ParticleBuffer::CHUNK_SIZE;
+	int* offsets = sliceCells.data() + (size_t)slice * (columns * rows + 1);
+	for (int index = slice * chunks / slices; index < (slice + 1) * chunks / slices; ++index)
+	{
+		const ParticleChunk& chunk = particles.getChunk(index);
+		int begin = index * ParticleBuffer::CHUNK_SIZE;
+		int size = std::min(ParticleBuffer::CHUNK_SIZE, particles.size() - begin);
+		const int* cells = particleCells.data() + begin;
+		for (int i = 0; i < size; ++i)
+		{
+			int entry = offsets[cells[i]]++;
+			Entry& sorted = sortedEntries[entry];
+			sorted.x = chunk.x[i];
+			sorted.y = chunk.y[i];
+			sorted.index = begin + i;
+			entries[begin + i] = entry;
+		}
+	}
+}
+
+void
+SpatialGrid::
+clear()
+{
+	std::fill(cellStart.begin(), cellStart.end(), 0);
+	count = 0;
+}
+
+int
+SpatialGrid::
+size() const
+{
+	return count;
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "ParticleBuffer.h"
+#include "ThreadPool.h"
+
+// Uniform grid over the particle positions of a ParticleBuffer, rebuilt
+// from scratch every step with a counting sort that runs one slice of
+// chunks per thread in parallel. The grid covers the viewport; particles
+// outside it are filed under the nearest border cell, so queries stay exact
+// everywhere and are only slower out there, unless setIncludeOutside(false)
+// leaves them out. Entries are stored sorted by cell along with a copy of
+// their positions, so a query streams through a few contiguous runs and
+// never touches the particle buffer. Particles are referred to by their
+// index in the buffer, which holds until the buffer changes.
+class SpatialGrid
+{
+public:
+	struct Entry
+	{
+		float x;
+		float y;
+		int index;
+	};
+
+private:
+	float cellSize;
+	float inverseCellSize;
+	int width;
+	int height;
+	int columns;
+	int rows;
+	int count;
+	bool includeOutside;
+
+	// first entry of every cell, then of the particles left out, plus one
+	// past the last entry
+	std::vector<int> cellStart;
+	// cell of every particle, and every slice's count and then offset per cell
+	std::vector<int> particleCells;
+	std::vector<int> sliceCells;
+	// position and buffer index of every particle, sorted by cell
+	std::vector<Entry> sortedEntries;
+	// entry of every particle, past the cells for the ones left out
+	std::vector<int> entries;
+
+	void resize();
+	void countSlice(const ParticleBuffer& particles, int slice, int slices);
+	void scatterSlice(const ParticleBuffer& particles, int slice, int slices);
+	int fileCell(float x, float y) const;
+
+	// truncating is flooring for the positive coordinates that aren't clamped
+	int clampColumn(float x) const
+	{
+		int column = x > 0 ? (int)(x * inverseCellSize) : 0;
+		return column >= columns ? columns - 1 : column;
+	}
+
+	int clampRow(float y) const
+	{
+		int row = y > 0 ? (int)(y * inverseCellSize) : 0;
+		return row >= rows ? rows - 1 : row;
+	}
+
+public:
+	SpatialGrid(float cellSize = 16, int width = 0, int height = 0);
+
+	// Changing the layout empties the grid until the next build
+	void setCellSize(float value);
+	float getCellSize() const;
+	void setBounds(int width, int height);
+
+	// Whether particles outside the bounds are filed under the border cells,
+	// or left out of every query
+	void setIncludeOutside(bool value);
+	bool getIncludeOutside() const;
+
+	int getColumns() const;
+	int getRows() const;
+	int getCell(float x, float y) const;
+
+	void build(const ParticleBuffer& particles, ThreadPool* threadPool = nullptr);
+	void clear();
+
+	// Number of particles in the grid
+	int size() const;
+
+	// Entries sorted by cell, the range of a cell and the entry of a particle,
+	// for walking cells directly
+	const Entry* getEntries() const { return sortedEntries.data(); }
+	int getCellBegin(int cell) const { return cellStart[cell]; }
+	int getCellEnd(int cell) const { return cellStart[cell + 1]; }
+	int getEntry(int particle) const { return entries[particle]; }
+
+	// Calls visit(index, x, y) for every particle in the rectangle
+	template <typename Visit>
+	void queryRect(float left, float top, float right, float bottom, Visit visit) const
+	{
+		if (count == 0 || right < left || bottom < top)
+			return;
+
+		int firstColumn = clampColumn(left);
+		int lastColumn = clampColumn(right);
+		int lastRow = clampRow(bottom);
+		for (int row = clampRow(top); row <= lastRow; ++row)
+		{
+			// the cells of a row are contiguous
+			int begin = cellStart[row * columns + firstColumn];
+			int end = cellStart[row * columns + lastColumn + 1];
+			for (int i = begin; i < end; ++i)
+			{
+				const Entry& entry = sortedEntries[i];
+				if (entry.x >= left && entry.x <= right && entry.y >= top && entry.y <= bottom)
+					visit(entry.index, entry.x, entry.y);
+			}
+		}
+	}
+
+	// Calls visit(index, x, y) for every particle within radius of (x, y)
+	template <typename Visit>
+	void queryRadius(float x, float y, float radius, Visit visit) const
+	{
+		float radius2 = radius * radius;
+		queryRect(x - radius, y - radius, x + radius, y + radius, [&](int index, float px, float py)
+		{
+			float dx = px - x;
+			float dy = py - y;
+			if (dx * dx + dy * dy <= radius2)
+				visit(index, px, py);
+		});
+	}
+
+	// Calls visit(other, x, y) for every other particle within radius of
+	// the given one
+	template <typename Visit>
+	void forEachNeighbor(int particle, float radius, Visit visit) const
+	{
+		const Entry& entry = sortedEntries[entries[particle]];
+		queryRadius(entry.x, entry.y, radius, [&](int other, float x, float y)
+		{
+			if (other != particle)
+				visit(other, x, y);
+		});
+	}
+};
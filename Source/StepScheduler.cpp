@@ -0,0 +1,182 @@
+#include "StepScheduler.h"
+
+#include <algorithm>
+
+namespace
+{
+	// Load above which spawns are throttled, and below which they recover
+	const float HIGH_LOAD = 0.8f;
+	const float LOW_LOAD = 0.5f;
+
+	const float THROTTLE_FACTOR = 0.75f;
+	const float RECOVERY_STEP = 0.05f;
+
+	// Weight of the last batch in the load average
+	const float LOAD_SMOOTHING = 0.25f;
+}
+
+const float StepScheduler::MIN_RATE_SCALE = 0.05f;
+
+StepScheduler::
+StepScheduler(Uint64 stepTicks, int maxSteps, Policy policy)
+: stepTicks(std::max<Uint64>(stepTicks, 1)),
+  maxSteps(std::max(maxSteps, 1)),
+  policy(policy),
+  throttling(true),
+  next(0),
+  batchCost(0),
+  load(0),
+  rateScale(1),
+  report({ 0, 0, 0 })
+{
+}
+
+void
+StepScheduler::
+setStepTicks(Uint64 value)
+{
+	stepTicks = std::max<Uint64>(value, 1);
+}
+
+Uint64
+StepScheduler::
+getStepTicks() const
+{
+	return stepTicks;
+}
+
+void
+StepScheduler::
+setMaxSteps(int value)
+{
+	maxSteps = std::max(value, 1);
+}
+
+int
+StepScheduler::
+getMaxSteps() const
+{
+	return maxSteps;
+}
+
+void
+StepScheduler::
+setPolicy(Policy value)
+{
+	policy = value;
+}
+
+StepScheduler::Policy
+StepScheduler::
+getPolicy() const
+{
+	return policy;
+}
+
+void
+StepScheduler::
+setThrottling(bool value)
+{
+	throttling = value;
+	if (!throttling)
+		rateScale = 1;
+}
+
+bool
+StepScheduler::
+getThrottling() const
+{
+	return throttling;
+}
+
+void
+StepScheduler::
+reset(Uint64 now)
+{
+	next = now;
+	batchCost = 0;
+	load = 0;
+	rateScale = 1;
+	report = { 0, 0, 0 };
+}
+
+Uint64
+StepScheduler::
+getNext() const
+{
+	return next;
+}
+
+int
+StepScheduler::
+schedule(Uint64 now)
+{
+	report = { 0, 0, 0 };
+	batchCost = 0;
+	if (now < next)
+		return 0;
+
+	int due = int(std::min<Uint64>((now - next) / stepTicks + 1, 1 << 30));
+	if (due <= maxSteps)
+		return due;
+
+	// Drop keeps one budget of steps, Slow lets a second one wait
+	int kept = policy == Slow ? 2 * maxSteps : maxSteps;
+	if (due > kept)
+	{
+		report.skipped = due - kept;
+		next = now - (kept - 1) * stepTicks;
+	}
+
+	return maxSteps;
+}
+
+void
+StepScheduler::
+stepped(Uint64 cost)
+{
+	next += stepTicks;
+	batchCost += cost;
+	++report.run;
+	if (rateScale < 1)
+		++report.throttled;
+}
+
+void
+StepScheduler::
+finish()
+{
+	if (report.run == 0)
+		return;
+
+	float batchLoad = float(batchCost) / (float(stepTicks) * report.run);
+	load += (batchLoad - load) * LOAD_SMOOTHING;
+	if (!throttling)
+		return;
+
+	if (report.skipped > 0 || load > HIGH_LOAD)
+		rateScale = std::max(rateScale * THROTTLE_FACTOR, MIN_RATE_SCALE);
+	else if (load < LOW_LOAD)
+		rateScale = std::min(rateScale + RECOVERY_STEP, 1.0f);
+}
+
+float
+StepScheduler::
+getRateScale() const
+{
+	return rateScale;
+}
+
+float
+StepScheduler::
+getLoad() const
+{
+	return load;
+}
+
+const StepScheduler::Report&
+StepScheduler::
+getReport() const
+{
+	return report;
+}
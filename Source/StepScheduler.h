@@ -0,0 +1,84 @@
+#pragma once
+
+#include "SDL/SDL.h"
+
+// Decides how many fixed steps to take to keep up with the clock, within a
+// budget of steps per batch so a slow step can't snowball into ever longer
+// batches. Time beyond the budget is either dropped or allowed to pile up
+// for a while, slowing the simulation down. It also watches how long steps
+// take compared to the step length, and suggests a lower spawn rate while
+// the simulation can't keep up. Times are performance counter ticks.
+class StepScheduler
+{
+public:
+	enum Policy
+	{
+		// Forget the time that doesn't fit in the budget
+		Drop,
+		// Run behind the clock by up to another budget's worth of steps,
+		// catching up when the load goes down
+		Slow
+	};
+
+	// What the last batch did
+	struct Report
+	{
+		int run;
+		int skipped;
+		// steps run with a lowered spawn rate
+		int throttled;
+	};
+
+	// Spawn rates are never scaled below this
+	static const float MIN_RATE_SCALE;
+
+	StepScheduler(Uint64 stepTicks, int maxSteps = 5, Policy policy = Drop);
+
+	void setStepTicks(Uint64 value);
+	Uint64 getStepTicks() const;
+
+	void setMaxSteps(int value);
+	int getMaxSteps() const;
+
+	void setPolicy(Policy value);
+	Policy getPolicy() const;
+
+	// Whether getRateScale() follows the load or stays at 1
+	void setThrottling(bool value);
+	bool getThrottling() const;
+
+	// Starts the clock over with the first step due at now
+	void reset(Uint64 now);
+
+	// When the next step is due
+	Uint64 getNext() const;
+
+	// Starts a batch: returns how many steps are due at now, within the
+	// budget, and moves the clock past the time it gives up on
+	int schedule(Uint64 now);
+
+	// Records a step of the batch that took cost ticks
+	void stepped(Uint64 cost);
+
+	// Ends the batch and adjusts the rate scale to the load
+	void finish();
+
+	// Factor to apply to spawn rates
+	float getRateScale() const;
+
+	// Average step duration over the step length
+	float getLoad() const;
+
+	const Report& getReport() const;
+
+private:
+	Uint64 stepTicks;
+	int maxSteps;
+	Policy policy;
+	bool throttling;
+	Uint64 next;
+	Uint64 batchCost;
+	float load;
+	float rateScale;
+	Report report;
+};
@@ -0,0 +1,150 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::
+ThreadPool(int threadCount)
+: task(nullptr),
+  taskCount(0),
+  nextTask(0),
+  busyWorkers(0),
+  generation(0),
+  stopping(false)
+{
+	start(threadCount);
+}
+
+ThreadPool::
+~ThreadPool()
+{
+	stop();
+}
+
+int
+ThreadPool::
+getHardwareThreadCount()
+{
+	return std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+void
+ThreadPool::
+setThreadCount(int value)
+{
+	if (value <= 0)
+		value = getHardwareThreadCount();
+
+	if (value == getThreadCount())
+		return;
+
+	stop();
+	start(value);
+}
+
+int
+ThreadPool::
+getThreadCount()
+{
+	return workers.size() + 1;
+}
+
+void
+ThreadPool::
+start(int threadCount)
+{
+	if (threadCount <= 0)
+		threadCount = getHardwareThreadCount();
+
+	// new workers only wake for runs that start after them
+	std::lock_guard<std::mutex> lock(mutex);
+	stopping = false;
+	for (int i = 1; i < threadCount; ++i)
+		workers.push_back(std::thread(&ThreadPool::work, this, generation));
+}
+
+void
+ThreadPool::
+stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (std::vector<std::thread>::iterator it = workers.begin(); it != workers.end(); ++it)
+		it->join();
+
+	workers.clear();
+}
+
+void
+ThreadPool::
+run(int count, const std::function<void(int)>& task)
+{
+	if (count <= 0)
+		return;
+
+	// nothing to share the work with
+	if (workers.empty() || count == 1)
+	{
+		for (int i = 0; i < count; ++i)
+			task(i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->task = &task;
+		taskCount = count;
+		nextTask = 0;
+		generation++;
+	}
+	wake.notify_all();
+
+	drain();
+
+	// the task must outlive every worker that may still be calling it
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this]() { return busyWorkers == 0; });
+	this->task = nullptr;
+}
+
+void
+ThreadPool::
+drain()
+{
+	for (int i = nextTask++; i < taskCount; i = nextTask++)
+		(*task)(i);
+}
+
+void
+ThreadPool::
+work(unsigned seen)
+{
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this, seen]() { return stopping || generation != seen; });
+			if (stopping)
+				return;
+
+			// a run that is already over was finished without this worker,
+			// and mustn't wait for it
+			seen = generation;
+			if (!task)
+				continue;
+
+			busyWorkers++;
+		}
+
+		drain();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			busyWorkers--;
+		}
+		done.notify_one();
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent pool of worker threads. run() hands out task indices to the
+// workers and to the calling thread, and returns once every task has
+// finished, so callers can split a range into chunks without spawning
+// threads every frame.
+class ThreadPool
+{
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	const std::function<void(int)>* task;
+	int taskCount;
+	std::atomic<int> nextTask;
+	// workers that took the current run and haven't finished it
+	int busyWorkers;
+	unsigned generation;
+	bool stopping;
+
+	void start(int threadCount);
+	void stop();
+	// Waits for runs after the given generation and works on them
+	void work(unsigned seen);
+	void drain();
+
+public:
+	// threadCount includes the calling thread; 0 uses one thread per core
+	ThreadPool(int threadCount = 0);
+	~ThreadPool();
+
+	static int getHardwareThreadCount();
+
+	void setThreadCount(int value);
+	int getThreadCount();
+
+	// Calls task(i) for every i in [0, count) and waits for all of them
+	void run(int count, const std::function<void(int)>& task);
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+
+// Lock-free handoff of the latest value from one producer thread to one
+// consumer thread. The producer fills the back slot and publishes it by
+// exchanging it with the middle one; the consumer takes the middle slot
+// when something new was published. Neither side ever waits, the producer
+// never touches the value being read, and values the consumer was too slow
+// to take are simply overwritten.
+template <typename T>
+class TripleBuffer
+{
+	// set on the middle slot index when it holds an unread value
+	static const int FRESH = 4;
+	static const int INDEX = 3;
+
+	T slots[3];
+	std::atomic<int> middle;
+	int back;
+	int front;
+
+public:
+	TripleBuffer()
+	: middle(1),
+	  back(0),
+	  front(2)
+	{
+	}
+
+	// Producer side: the slot to fill, with whatever it held three
+	// publications ago
+	T&
+	getBack()
+	{
+		return slots[back];
+	}
+
+	void
+	publish()
+	{
+		back = middle.exchange(back | FRESH) & INDEX;
+	}
+
+	// Consumer side: takes the latest published value, if there is a new one
+	bool
+	update()
+	{
+		if (!(middle.load() & FRESH))
+			return false;
+
+		front = middle.exchange(front) & INDEX;
+		return true;
+	}
+
+	const T&
+	getFront()
+	{
+		return slots[front];
+	}
+};
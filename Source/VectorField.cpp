@@ -0,0 +1,251 @@
+#include "VectorField.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "SDL/SDL.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define VECTOR_FIELD_SSE2
+#include <emmintrin.h>
+#endif
+
+VectorField::
+VectorField(int columns, int rows, const Vector2& topLeft, float cellSize)
+: columns(0),
+  rows(0),
+  left(topLeft.x),
+  top(topLeft.y),
+  cellSize(cellSize > 0 ? cellSize : 1)
+{
+	resize(columns, rows);
+}
+
+void
+VectorField::
+resize(int columns, int rows)
+{
+	this->columns = std::max(columns, 1);
+	this->rows = std::max(rows, 1);
+	samples.assign((size_t)this->columns * this->rows * 4, 0.0f);
+}
+
+int
+VectorField::
+getColumns() const
+{
+	return columns;
+}
+
+int
+VectorField::
+getRows() const
+{
+	return rows;
+}
+
+void
+VectorField::
+setPlacement(const Vector2& topLeft, float cellSize)
+{
+	left = topLeft.x;
+	top = topLeft.y;
+	this->cellSize = cellSize > 0 ? cellSize : 1;
+}
+
+void
+VectorField::
+store(int column, int row, float x, float y)
+{
+	// the sample's own slot, and its copy next to its left neighbour; the
+	// last column is its own right neighbour
+	float* texel = samples.data() + ((size_t)row * columns + column) * 4;
+	texel[0] = x;
+	texel[1] = y;
+	if (column == columns - 1)
+	{
+		texel[2] = x;
+		texel[3] = y;
+	}
+	if (column > 0)
+	{
+		texel[-2] = x;
+		texel[-1] = y;
+	}
+}
+
+void
+VectorField::
+set(int column, int row, const Vector2& value)
+{
+	if (column >= 0 && column < columns && row >= 0 && row < rows)
+		store(column, row, value.x, value.y);
+}
+
+Vector2
+VectorField::
+get(int column, int row) const
+{
+	column = std::min(std::max(column, 0), columns - 1);
+	row = std::min(std::max(row, 0), rows - 1);
+	const float* texel = samples.data() + ((size_t)row * columns + column) * 4;
+	return Vector2(texel[0], texel[1]);
+}
+
+void
+VectorField::
+update(int column, int row, int width, int height, const float* values, int stride)
+{
+	for (int j = std::max(row, 0); j < std::min(row + height, rows); ++j)
+	{
+		for (int i = std::max(column, 0); i < std::min(column + width, columns); ++i)
+		{
+			const float* value = values + ((size_t)(j - row) * stride + (i - column)) * 2;
+			store(i, j, value[0], value[1]);
+		}
+	}
+}
+
+bool
+VectorField::
+load(const char* path)
+{
+	// "PF", the size and the scale, negative for little endian, then the
+	// rows of RGB floats from the bottom one up
+	FILE* file = fopen(path, "rb");
+	if (!file)
+		return false;
+
+	char magic[3] = { 0 };
+	int width = 0;
+	int height = 0;
+	float scale = 0;
+	bool success = fscanf(file, "%2s %d %d %f", magic, &width, &height, &scale) == 4 && !strcmp(magic, "PF") && width > 0 && height > 0 && scale != 0 && fgetc(file) != EOF;
+	std::vector<float> pixels;
+	if (success)
+	{
+		pixels.resize((size_t)width * height * 3);
+		success = fread(pixels.data(), sizeof(float), pixels.size(), file) == pixels.size();
+	}
+	fclose(file);
+	if (!success)
+		return false;
+
+	if ((scale < 0) != (SDL_BYTEORDER == SDL_LIL_ENDIAN))
+	{
+		for (size_t i = 0; i < pixels.size(); ++i)
+		{
+			unsigned char* bytes = reinterpret_cast<unsigned char*>(&pixels[i]);
+			std::swap(bytes[0], bytes[3]);
+			std::swap(bytes[1], bytes[2]);
+		}
+	}
+
+	resize(width, height);
+	for (int row = 0; row < height; ++row)
+	{
+		for (int column = 0; column < width; ++column)
+		{
+			const float* pixel = pixels.data() + ((size_t)(height - 1 - row) * width + column) * 3;
+			store(column, row, pixel[0], pixel[1]);
+		}
+	}
+
+	return true;
+}
+
+Vector2
+VectorField::
+sample(const Vector2& position) const
+{
+	float x = 0;
+	float y = 0;
+	accumulate(&position.x, &position.y, 1, 1, &x, &y);
+	return Vector2(x, y);
+}
+
+void
+VectorField::
+accumulate(const float* x, const float* y, int count, float scale, float* outX, float* outY) const
+{
+	// Grid coordinates clamped to the samples, NaN included; the column
+	// and row under them hold the top left of the four samples around
+	float inverse = 1 / cellSize;
+	float lastColumn = (float)(columns - 1);
+	float lastRow = (float)(rows - 1);
+	int below = columns * 4;
+	int i = 0;
+#if defined(VECTOR_FIELD_SSE2)
+	const __m128 left4 = _mm_set1_ps(left);
+	const __m128 top4 = _mm_set1_ps(top);
+	const __m128 inverse4 = _mm_set1_ps(inverse);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 lastColumn4 = _mm_set1_ps(lastColumn);
+	const __m128 lastRow4 = _mm_set1_ps(lastRow);
+	const __m128 scale4 = _mm_set1_ps(scale);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 gx = _mm_min_ps(_mm_max_ps(_mm_sub_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(x + i), left4), inverse4), half), _mm_setzero_ps()), lastColumn4);
+		__m128 gy = _mm_min_ps(_mm_max_ps(_mm_sub_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(y + i), top4), inverse4), half), _mm_setzero_ps()), lastRow4);
+		__m128i column = _mm_cvttps_epi32(gx);
+		__m128i row = _mm_cvttps_epi32(gy);
+		__m128 across = _mm_sub_ps(gx, _mm_cvtepi32_ps(column));
+		__m128 down = _mm_sub_ps(gy, _mm_cvtepi32_ps(row));
+		int columnOf[4];
+		int rowOf[4];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(columnOf), column);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(rowOf), row);
+
+		// every particle's sample and right neighbour, and the pair below,
+		// transposed into vectors of the same corner for the four particles
+		const float* texels[4];
+		int lasts[4];
+		for (int k = 0; k < 4; ++k)
+		{
+			texels[k] = samples.data() + ((size_t)rowOf[k] * columns + columnOf[k]) * 4;
+			lasts[k] = rowOf[k] == rows - 1 ? 0 : below;
+		}
+		__m128 topLeftX = _mm_loadu_ps(texels[0]);
+		__m128 topLeftY = _mm_loadu_ps(texels[1]);
+		__m128 topRightX = _mm_loadu_ps(texels[2]);
+		__m128 topRightY = _mm_loadu_ps(texels[3]);
+		_MM_TRANSPOSE4_PS(topLeftX, topLeftY, topRightX, topRightY);
+		__m128 bottomLeftX = _mm_loadu_ps(texels[0] + lasts[0]);
+		__m128 bottomLeftY = _mm_loadu_ps(texels[1] + lasts[1]);
+		__m128 bottomRightX = _mm_loadu_ps(texels[2] + lasts[2]);
+		__m128 bottomRightY = _mm_loadu_ps(texels[3] + lasts[3]);
+		_MM_TRANSPOSE4_PS(bottomLeftX, bottomLeftY, bottomRightX, bottomRightY);
+
+		// blended down then across, like the scalar loop
+		__m128 leftX = _mm_add_ps(topLeftX, _mm_mul_ps(_mm_sub_ps(bottomLeftX, topLeftX), down));
+		__m128 leftY = _mm_add_ps(topLeftY, _mm_mul_ps(_mm_sub_ps(bottomLeftY, topLeftY), down));
+		__m128 rightX = _mm_add_ps(topRightX, _mm_mul_ps(_mm_sub_ps(bottomRightX, topRightX), down));
+		__m128 rightY = _mm_add_ps(topRightY, _mm_mul_ps(_mm_sub_ps(bottomRightY, topRightY), down));
+		__m128 valueX = _mm_add_ps(leftX, _mm_mul_ps(_mm_sub_ps(rightX, leftX), across));
+		__m128 valueY = _mm_add_ps(leftY, _mm_mul_ps(_mm_sub_ps(rightY, leftY), across));
+		_mm_storeu_ps(outX + i, _mm_add_ps(_mm_loadu_ps(outX + i), _mm_mul_ps(valueX, scale4)));
+		_mm_storeu_ps(outY + i, _mm_add_ps(_mm_loadu_ps(outY + i), _mm_mul_ps(valueY, scale4)));
+	}
+#endif
+	for (; i < count; ++i)
+	{
+		float gx = (x[i] - left) * inverse - 0.5f;
+		float gy = (y[i] - top) * inverse - 0.5f;
+		gx = gx > 0 ? (gx < lastColumn ? gx : lastColumn) : 0;
+		gy = gy > 0 ? (gy < lastRow ? gy : lastRow) : 0;
+		int column = (int)gx;
+		int row = (int)gy;
+		float across = gx - column;
+		float down = gy - row;
+		int last = row == rows - 1 ? 0 : below;
+		const float* a = samples.data() + ((size_t)row * columns + column) * 4;
+		const float* b = a + last;
+		float leftX = a[0] + (b[0] - a[0]) * down;
+		float leftY = a[1] + (b[1] - a[1]) * down;
+		float rightX = a[2] + (b[2] - a[2]) * down;
+		float rightY = a[3] + (b[3] - a[3]) * down;
+		outX[i] += (leftX + (rightX - leftX) * across) * scale;
+		outY[i] += (leftY + (rightY - leftY) * across) * scale;
+	}
+}
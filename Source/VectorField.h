@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+
+#include "Vector2.h"
+
+// A grid of 2D vectors over a rectangle of the screen, such as a wind map,
+// sampled anywhere with bilinear interpolation. Samples sit at the centers
+// of the cells, and positions off the grid get the value of the nearest
+// edge. Every sample is stored along with its right neighbour, so the four
+// vectors around a position are two 16 byte loads rather than eight
+// scattered ones, and sample() interpolates four positions at a time with
+// SSE2. Samples can be rewritten in place between updates; only resize()
+// and load() allocate.
+//
+// The update pass reads the field from the thread pool's threads, so it
+// must only change between updates, on the thread that runs them: from a
+// command posted to the SimulationThread while one runs the system.
+class VectorField
+{
+	int columns;
+	int rows;
+	float left;
+	float top;
+	float cellSize;
+	// per sample: x and y, then x and y of the sample to its right
+	std::vector<float> samples;
+
+	void store(int column, int row, float x, float y);
+
+public:
+	VectorField(int columns = 1, int rows = 1, const Vector2& topLeft = Vector2::Zero, float cellSize = 1);
+
+	// Changes the number of samples, clearing them all to zero
+	void resize(int columns, int rows);
+	int getColumns() const;
+	int getRows() const;
+
+	// Where the grid's top left corner lies and how far apart its samples
+	// are, in pixels
+	void setPlacement(const Vector2& topLeft, float cellSize);
+
+	void set(int column, int row, const Vector2& value);
+	Vector2 get(int column, int row) const;
+
+	// Overwrites a rectangle of samples from x, y pairs, stride pairs apart
+	// from one row to the next
+	void update(int column, int row, int width, int height, const float* values, int stride);
+
+	// Loads a color portable float map (.pfm), its red and green channels
+	// being the x and y of every sample, and resizes to match
+	bool load(const char* path);
+
+	Vector2 sample(const Vector2& position) const;
+
+	// Adds scale times the field at count positions to outX, outY
+	void accumulate(const float* x, const float* y, int count, float scale, float* outX, float* outY) const;
+};
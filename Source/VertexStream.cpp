@@ -0,0 +1,247 @@
+#include "VertexStream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+VertexStream::
+VertexStream(VertexFormat format)
+: format(format),
+  stride(getStride(format)),
+  count(0),
+  vertexCapacity(0),
+  motion(false)
+{
+}
+
+int
+VertexStream::
+getStride(VertexFormat format)
+{
+	switch (format)
+	{
+	case SpriteVertex:
+		return sizeof(ParticleSprite);
+
+	case PackedVertex:
+		return sizeof(PackedParticle);
+
+	default:
+		return sizeof(ParticleVertex);
+	}
+}
+
+void
+VertexStream::
+setFormat(VertexFormat value)
+{
+	if (value == format)
+		return;
+
+	format = value;
+	stride = getStride(format);
+	reserve(vertexCapacity);
+}
+
+VertexFormat
+VertexStream::
+getFormat() const
+{
+	return format;
+}
+
+int
+VertexStream::
+getStride() const
+{
+	return stride;
+}
+
+void
+VertexStream::
+setMotion(bool value)
+{
+	if (value == motion)
+		return;
+
+	motion = value;
+	reserve(vertexCapacity);
+}
+
+bool
+VertexStream::
+hasMotion() const
+{
+	return motion;
+}
+
+void
+VertexStream::
+reserve(int capacity)
+{
+	// the stream is rebuilt every update, so there is nothing to copy over
+	std::vector<unsigned char>((size_t)capacity * stride).swap(bytes);
+	std::vector<float>(motion ? (size_t)capacity * 2 : 0).swap(displacements);
+	vertexCapacity = capacity;
+	count = 0;
+}
+
+int
+VertexStream::
+capacity() const
+{
+	return vertexCapacity;
+}
+
+void
+VertexStream::
+grow(int capacity)
+{
+	if (capacity <= vertexCapacity)
+		return;
+
+	vertexCapacity = std::max(capacity, vertexCapacity + vertexCapacity / 2);
+	bytes.resize((size_t)vertexCapacity * stride);
+	if (motion)
+		displacements.resize((size_t)vertexCapacity * 2);
+}
+
+int
+VertexStream::
+size() const
+{
+	return count;
+}
+
+void
+VertexStream::
+resize(int value)
+{
+	count = value < 0 ? 0 : value > vertexCapacity ? vertexCapacity : value;
+}
+
+void
+VertexStream::
+clear()
+{
+	count = 0;
+}
+
+void
+VertexStream::
+swap(VertexStream& other)
+{
+	std::swap(format, other.format);
+	std::swap(stride, other.stride);
+	std::swap(count, other.count);
+	std::swap(vertexCapacity, other.vertexCapacity);
+	std::swap(motion, other.motion);
+	bytes.swap(other.bytes);
+	displacements.swap(other.displacements);
+}
+
+void
+VertexStream::
+move(int from, int to, int n)
+{
+	if (from == to || n <= 0)
+		return;
+
+	std::memmove(at(to), at(from), (size_t)n * stride);
+	if (motion)
+		std::memmove(motionAt(to), motionAt(from), (size_t)n * 2 * sizeof(float));
+}
+
+void*
+VertexStream::
+at(int index)
+{
+	return bytes.data() + (size_t)index * stride;
+}
+
+const void*
+VertexStream::
+at(int index) const
+{
+	return bytes.data() + (size_t)index * stride;
+}
+
+const void*
+VertexStream::
+data() const
+{
+	return bytes.data();
+}
+
+float*
+VertexStream::
+motionAt(int index)
+{
+	return displacements.data() + (size_t)index * 2;
+}
+
+const float*
+VertexStream::
+getMotion() const
+{
+	return displacements.data();
+}
+
+void
+VertexStream::
+interpolate(float alpha, int width, int height, VertexStream& out) const
+{
+	out.setMotion(false);
+	out.setFormat(format);
+	if (out.capacity() < count)
+		out.reserve(count);
+	out.resize(count);
+	std::memcpy(out.at(0), data(), (size_t)count * stride);
+	if (!motion)
+		return;
+
+	// previous = current - displacement, so the blend of the two positions
+	// is current - displacement * (1 - alpha)
+	float back = 1 - alpha;
+	const float* displacement = getMotion();
+	switch (format)
+	{
+	case SpriteVertex:
+	{
+		ParticleSprite* vertex = static_cast<ParticleSprite*>(out.at(0));
+		for (int i = 0; i < count; ++i, displacement += 2)
+		{
+			vertex[i].x -= displacement[0] * back;
+			vertex[i].y -= displacement[1] * back;
+		}
+		break;
+	}
+
+	case PackedVertex:
+	{
+		// displacements are in pixels, positions in 1/65535ths of the viewport
+		float scaleX = back * 65535.f / width;
+		float scaleY = back * 65535.f / height;
+		PackedParticle* vertex = static_cast<PackedParticle*>(out.at(0));
+		for (int i = 0; i < count; ++i, displacement += 2)
+		{
+			float x = vertex[i].x - displacement[0] * scaleX + 0.5f;
+			float y = vertex[i].y - displacement[1] * scaleY + 0.5f;
+			vertex[i].x = (unsigned short)(x < 0 ? 0 : x > 65535 ? 65535 : x);
+			vertex[i].y = (unsigned short)(y < 0 ? 0 : y > 65535 ? 65535 : y);
+		}
+		break;
+	}
+
+	default:
+	{
+		ParticleVertex* vertex = static_cast<ParticleVertex*>(out.at(0));
+		for (int i = 0; i < count; ++i, displacement += 2)
+		{
+			vertex[i].x -= displacement[0] * back;
+			vertex[i].y -= displacement[1] * back;
+		}
+		break;
+	}
+	}
+}
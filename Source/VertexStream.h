@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+
+#include "ParticleVertex.h"
+
+// Vertices of one emitter in one of the VertexFormat layouts, rebuilt every
+// update. The storage grows with the particles drawn and is only
+// reallocated when it has to grow or the format changes.
+class VertexStream
+{
+public:
+	VertexStream(VertexFormat format = ColoredVertex);
+
+	static int getStride(VertexFormat format);
+
+	// Switching format discards the vertices
+	void setFormat(VertexFormat value);
+	VertexFormat getFormat() const;
+	int getStride() const;
+
+	// Whether the stream also records how far every vertex moved during
+	// the last step, for drawing in between steps; discards the vertices
+	void setMotion(bool value);
+	bool hasMotion() const;
+
+	// Discards the vertices
+	void reserve(int capacity);
+	int capacity() const;
+
+	// Makes room for at least capacity vertices, keeping the ones there are;
+	// grows by half again at least, so a stream filling up over many
+	// updates is only reallocated a few times
+	void grow(int capacity);
+
+	int size() const;
+	void resize(int count);
+	void clear();
+
+	// Exchanges the vertices, format and capacity of two streams
+	void swap(VertexStream& other);
+
+	// Moves count vertices from one index to another, the ranges may overlap
+	void move(int from, int to, int count);
+
+	void* at(int index);
+	const void* at(int index) const;
+	const void* data() const;
+
+	// x and y displacement of a vertex, when the stream has motion
+	float* motionAt(int index);
+	const float* getMotion() const;
+
+	// Copies the vertices moved back to where they were a fraction alpha
+	// of the way through the last step
+	void interpolate(float alpha, int width, int height, VertexStream& out) const;
+
+private:
+	VertexFormat format;
+	int stride;
+	int count;
+	int vertexCapacity;
+	std::vector<unsigned char> bytes;
+	bool motion;
+	std::vector<float> displacements;
+};
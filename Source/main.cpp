@@ -1,8 +1,11 @@
+#include <algorithm>
+#include <cmath>
 #include <cstdio>
 #include <string>
 #include <cstring>
 #include <ctime>
 #include <iostream>
+#include <vector>
 
 #if defined(_WIN32)
 #include <windows.h>
@@ -20,6 +23,16 @@
 #include "Extensions.h"
 #include "Body.h"
 #include "Emitter.h"
+#include "FrameCapture.h"
+#include "FrameLimiter.h"
+#include "GLFunctions.h"
+#include "Integrator.h"
+#include "ParticleRenderer.h"
+#include "ParticleSystem.h"
+#include "Random.h"
+#include "SimulationThread.h"
+#include "SoftwareRenderer.h"
+#include "ThreadPool.h"
 #include "Vector2.h"
 
 // Constants 
@@ -27,6 +40,8 @@ const int SCREEN_WIDTH = 1024;
 const int SCREEN_HEIGHT = 600;
 
 const float FIXED_DELTA_TIME = 0.022;
+// How long an idle main loop waits for an event before drawing again, in ms
+const int IDLE_TIMEOUT = 250;
 
 void pause()
 {
@@ -49,13 +64,28 @@ void error(const char* fmt, ...)
 class Simulation
 {
 	MainScreen* settings;
+	ThreadPool* threadPool;
+	ParticleRenderer* renderer;
+	ParticleSystem* system;
 	Emitter* emitter;
 	Body* body;
+	SimulationThread* simulationThread;
+	// the snapshot's vertices moved to the render time
+	VertexStream interpolated;
+	bool interpolate;
+	FrameLimiter frameLimiter;
+	bool idleWhenEmpty;
 	bool dragging;
 
+	// Runs command on the simulation thread, which owns the particle system
+	void post(const std::function<void()>& command)
+	{
+		simulationThread->post(command);
+	}
+
 	void Settings_EnableChanged(bool value)
 	{
-		emitter->setEnabled(value);
+		post([=] { emitter->setEnabled(value); });
 	}
 
 	void Settings_ColorChanged(const nanogui::Color& value)
@@ -65,67 +95,154 @@ class Simulation
 		color.g = value.g() * 255;
 		color.b = value.b() * 255;
 		color.a = 255;
-		emitter->setColor(color);
+		post([=] { emitter->setColor(color); });
 	}
 
 	void Settings_MaxParticlesChanged(int value)
 	{
-		emitter->setMaxParticles(value);
+		post([=] { emitter->setMaxParticles(value); });
 	}
 
 	void Settings_ParticleSizeChanged(float value)
 	{
-		emitter->setParticleSize(value);
+		post([=] { emitter->setParticleSize(value); });
 	}
 
 	void Settings_LifeTimeChanged(float value)
 	{
-		emitter->setLifeTime(value);
+		post([=] { emitter->setLifeTime(value); });
 	}
 
 	void Settings_FadeChanged(bool value)
 	{
-		emitter->setFade(value);
+		post([=] { emitter->setFade(value); });
 	}
 
 	void Settings_RateChanged(float value)
 	{
-		emitter->setRate(value);
+		post([=] { emitter->setRate(value); });
 	}
 
 	void Settings_RadiusChanged(float value)
 	{
-		emitter->setRadius(value);
+		post([=] { emitter->setRadius(value); });
 	}
 
 	void Settings_AngleChanged(float value)
 	{
-		emitter->setAngle(value);
+		post([=] { emitter->setAngle(value); });
 	}
 
 	void Settings_SpreadChanged(float value)
 	{
-		emitter->setSpread(value);
+		post([=] { emitter->setSpread(value); });
 	}
 
 	void Settings_MinSpeedChanged(float value)
 	{
-		emitter->setMinSpeed(value);
+		post([=] { emitter->setMinSpeed(value); });
 	}
 
 	void Settings_MaxSpeedChanged(float value)
 	{
-		emitter->setMaxSpeed(value);
+		post([=] { emitter->setMaxSpeed(value); });
 	}
 
 	void Settings_GravityChanged(float value)
 	{
-		emitter->setGravity(value);
+		post([=] { emitter->setGravity(value); });
+	}
+
+	void Settings_CollisionsChanged(int value)
+	{
+		post([=] { system->setCollisionIterations(value); });
+	}
+
+	void Settings_InteractionChanged(int value)
+	{
+		post([=] { system->getNBodySolver().setMode(NBodySolver::Mode(value)); });
+	}
+
+	void Settings_ParticleForcesChanged(bool value)
+	{
+		post([=] { system->getNBodySolver().setParticleSources(value); });
+	}
+
+	void Settings_OpeningAngleChanged(float value)
+	{
+		post([=] { system->getNBodySolver().setOpeningAngle(value); });
+	}
+
+	void Settings_ThreadsChanged(int value)
+	{
+		post([=] { threadPool->setThreadCount(value); });
+	}
+
+	void Settings_RendererChanged(int value)
+	{
+		renderer->setMode(ParticleRenderer::Mode(value));
+		VertexFormat format = renderer->getVertexFormat();
+		post([=] { system->setVertexFormat(format); });
+	}
+
+	void Settings_StepTimeChanged(float value)
+	{
+		simulationThread->setStepTime(std::max(value, 1.0f) / 1000);
+	}
+
+	void Settings_InterpolateChanged(bool value)
+	{
+		interpolate = value;
+		post([=] { system->setInterpolation(value); });
+	}
+
+	void Settings_MaxStepsChanged(int value)
+	{
+		simulationThread->setMaxSteps(value);
+	}
+
+	void Settings_OverloadChanged(int value)
+	{
+		simulationThread->setOverloadPolicy(StepScheduler::Policy(value));
+	}
+
+	void Settings_ThrottleChanged(bool value)
+	{
+		simulationThread->setThrottling(value);
+	}
+
+	void Settings_MaxFPSChanged(int value)
+	{
+		frameLimiter.setMaxFPS(value);
+	}
+
+	void Settings_VSyncChanged(int value)
+	{
+		setVSync(value);
+	}
+
+	void Settings_IdleChanged(bool value)
+	{
+		idleWhenEmpty = value;
+	}
+
+	// 0 turns vsync off, 1 on, and 2 makes it adaptive: late frames are
+	// shown right away instead of waiting for the next refresh
+	void setVSync(int mode)
+	{
+		if (SDL_GL_SetSwapInterval(mode == 2 ? -1 : mode) == 0)
+			return;
+
+		fprintf(stderr, "WARNING: Could not set the swap interval! SDL Error: %s\n", SDL_GetError());
+		if (mode == 2)
+			SDL_GL_SetSwapInterval(1);
 	}
 
 public:
 	Simulation(const std::string& title, SDL_Window* window, int width, int height)
-		: dragging(false)
+		: interpolate(false),
+		  idleWhenEmpty(false),
+		  dragging(false)
 	{
 		Vector2 startPosition(width / 2, height / 2);
 
@@ -139,8 +256,6 @@ public:
 
 		emitter = new Emitter(
 			startPosition,
-			width,
-			height,
 			settings->getRate(),
 			settings->getParticleSize(),
 			settings->getLifeTime(),
@@ -155,7 +270,26 @@ public:
 			sdlColor
 			
 		);
+		threadPool = new ThreadPool(settings->getThreads());
+		renderer = new ParticleRenderer(ParticleRenderer::Mode(settings->getRenderer()));
 		body = new Body(emitter, startPosition);
+		system = new ParticleSystem(width, height);
+		system->add(body);
+		system->setThreadPool(threadPool);
+		system->setVertexFormat(renderer->getVertexFormat());
+		interpolate = settings->getInterpolate();
+		system->setInterpolation(interpolate);
+		system->setCollisionIterations(settings->getCollisions());
+		system->getNBodySolver().setMode(NBodySolver::Mode(settings->getInteraction()));
+		system->getNBodySolver().setParticleSources(settings->getParticleForces());
+		system->getNBodySolver().setOpeningAngle(settings->getOpeningAngle());
+		simulationThread = new SimulationThread(system, settings->getStepTime() / 1000);
+		simulationThread->setMaxSteps(settings->getMaxSteps());
+		simulationThread->setOverloadPolicy(StepScheduler::Policy(settings->getOverload()));
+		simulationThread->setThrottling(settings->getThrottle());
+		frameLimiter.setMaxFPS(settings->getMaxFPS());
+		setVSync(settings->getVSync());
+		idleWhenEmpty = settings->getIdle();
 
 		settings->enableChanged = std::bind(&Simulation::Settings_EnableChanged, this, std::placeholders::_1);
 		settings->colorChanged = std::bind(&Simulation::Settings_ColorChanged, this, std::placeholders::_1);
@@ -170,27 +304,55 @@ public:
 		settings->minSpeedChanged = std::bind(&Simulation::Settings_MinSpeedChanged, this, std::placeholders::_1);
 		settings->maxSpeedChanged = std::bind(&Simulation::Settings_MaxSpeedChanged, this, std::placeholders::_1);
 		settings->gravityChanged = std::bind(&Simulation::Settings_GravityChanged, this, std::placeholders::_1);
+		settings->collisionsChanged = std::bind(&Simulation::Settings_CollisionsChanged, this, std::placeholders::_1);
+		settings->interactionChanged = std::bind(&Simulation::Settings_InteractionChanged, this, std::placeholders::_1);
+		settings->particleForcesChanged = std::bind(&Simulation::Settings_ParticleForcesChanged, this, std::placeholders::_1);
+		settings->openingAngleChanged = std::bind(&Simulation::Settings_OpeningAngleChanged, this, std::placeholders::_1);
+		settings->threadsChanged = std::bind(&Simulation::Settings_ThreadsChanged, this, std::placeholders::_1);
+		settings->rendererChanged = std::bind(&Simulation::Settings_RendererChanged, this, std::placeholders::_1);
+		settings->stepTimeChanged = std::bind(&Simulation::Settings_StepTimeChanged, this, std::placeholders::_1);
+		settings->interpolateChanged = std::bind(&Simulation::Settings_InterpolateChanged, this, std::placeholders::_1);
+		settings->maxStepsChanged = std::bind(&Simulation::Settings_MaxStepsChanged, this, std::placeholders::_1);
+		settings->overloadChanged = std::bind(&Simulation::Settings_OverloadChanged, this, std::placeholders::_1);
+		settings->throttleChanged = std::bind(&Simulation::Settings_ThrottleChanged, this, std::placeholders::_1);
+		settings->maxFPSChanged = std::bind(&Simulation::Settings_MaxFPSChanged, this, std::placeholders::_1);
+		settings->vsyncChanged = std::bind(&Simulation::Settings_VSyncChanged, this, std::placeholders::_1);
+		settings->idleChanged = std::bind(&Simulation::Settings_IdleChanged, this, std::placeholders::_1);
+
+		simulationThread->start();
 	}
 
 	~Simulation()
 	{
-		delete body;
-		delete emitter;
+		delete simulationThread;
+		delete system;
+		delete threadPool;
+		delete renderer;
 		delete settings;
 	}
 
+	// Called once per frame: sends the dragged position to the simulation
+	// and picks up the latest snapshot
 	void
-	update(float deltaTime)
+	update()
 	{
 		if (dragging)
 		{
 			int x, y;
 			SDL_GetMouseState(&x, &y);
-			body->position.x = x;
-			body->position.y = y;
+			Vector2 position(x, y);
+			post([=] { body->position = position; });
+		}
+
+		if (simulationThread->update())
+		{
+			const Snapshot& snapshot = simulationThread->getSnapshot();
+			settings->setParticleCount(snapshot.particleCount);
+			settings->setUpdateTime(snapshot.updateTime);
+			settings->setAllocations(snapshot.allocations);
+			settings->setSimRate(snapshot.stepRate);
+			settings->setSteps(snapshot.stepsRun, snapshot.stepsSkipped, snapshot.stepsThrottled);
 		}
-		body->update(deltaTime);
-		settings->setParticleCount(emitter->getParticleCount());
 	}
 
 	void
@@ -202,7 +364,8 @@ public:
 			if (e.button.button == SDL_BUTTON_LEFT)
 			{
 				Vector2 mousePosition(e.button.x, e.button.y);
-				if (Vector2::Distance(mousePosition, body->position) < 10)
+				const Snapshot& snapshot = simulationThread->getSnapshot();
+				if (!snapshot.bodies.empty() && Vector2::Distance(mousePosition, snapshot.bodies[0].position) < 10)
 					dragging = true;
 			}
 			break;
@@ -225,7 +388,13 @@ public:
 		glLoadIdentity();
 		gluOrtho2D(0.0f, SCREEN_WIDTH, SCREEN_HEIGHT, 0.0f);
 
-		body->render();
+		// Draw in between the last two steps so motion stays smooth when the
+		// simulation steps less often than the screen refreshes
+		const Snapshot& snapshot = simulationThread->getSnapshot();
+		if (interpolate)
+			snapshot.render(*renderer, snapshot.getAlpha(SDL_GetPerformanceCounter()), interpolated);
+		else
+			snapshot.render(*renderer);
 
 		settings->drawAll();
 	}
@@ -235,12 +404,562 @@ public:
 	{
 		settings->setFPS(value);
 	}
+
+	// Whether the last frame had nothing moving in it, so the next one
+	// only needs drawing when something happens
+	bool
+	isIdle()
+	{
+		const Snapshot& snapshot = simulationThread->getSnapshot();
+		return idleWhenEmpty && !dragging && !settings->getEnabled() && snapshot.particleCount == 0;
+	}
+
+	// Holds the frame rate to the configured cap
+	void
+	waitForNextFrame()
+	{
+		frameLimiter.wait();
+	}
+};
+
+// Value of a command line option given as "--name value", or nullptr
+const char* getOption(int argc, char* args[], const char* name, const char* defaultValue = nullptr)
+{
+	for (int i = 1; i + 1 < argc; ++i)
+		if (!strcmp(args[i], name))
+			return args[i + 1];
+
+	return defaultValue;
+}
+
+// Whether a command line flag such as --headless was given
+bool hasOption(int argc, char* args[], const char* name)
+{
+	for (int i = 1; i < argc; ++i)
+		if (!strcmp(args[i], name))
+			return true;
+
+	return false;
+}
+
+// Capture to an image sequence when --capture gives a file name prefix,
+// with --capture-format png|raw and --capture-policy drop|block
+FrameCapture* createCapture(int argc, char* args[], FrameCapture::Policy defaultPolicy)
+{
+	const char* prefix = getOption(argc, args, "--capture");
+	if (!prefix)
+		return nullptr;
+
+	const char* format = getOption(argc, args, "--capture-format", "png");
+	const char* policy = getOption(argc, args, "--capture-policy", defaultPolicy == FrameCapture::Block ? "block" : "drop");
+	return new FrameCapture(prefix, SCREEN_WIDTH, SCREEN_HEIGHT,
+		strcmp(format, "raw") ? FrameCapture::PNG : FrameCapture::Raw,
+		strcmp(policy, "block") ? FrameCapture::Drop : FrameCapture::Block);
+}
+
+// Waits for the capture to be written out, then reports on it
+void finishCapture(FrameCapture* capture)
+{
+	if (!capture)
+		return;
+
+	capture->flush();
+	FrameCapture::Stats stats = capture->getStats();
+	printf("Captured %d frames: %d written, %d dropped, encode latency %.1f ms average, %.1f ms max\n",
+		stats.captured, stats.written, stats.dropped, stats.averageLatency, stats.maxLatency);
+	delete capture;
+}
+
+// Runs pass once to warm up, then as many times as fit in half a second,
+// and returns its average time in milliseconds
+double timePasses(const std::function<void()>& pass)
+{
+	pass();
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+	int passes = 0;
+	Uint64 start = SDL_GetPerformanceCounter();
+	Uint64 end = start;
+	while (end - start < frequency / 2)
+	{
+		pass();
+		++passes;
+		end = SDL_GetPerformanceCounter();
+	}
+
+	return double(end - start) * 1000 / frequency / passes;
+}
+
+// Times Integrator::integrate on count particles with every instruction set
+// the CPU supports and reports the throughput of each
+int benchmarkIntegrator(int count)
+{
+	std::vector<float> x(count);
+	std::vector<float> y(count);
+	std::vector<float> vx(count);
+	std::vector<float> vy(count);
+	std::vector<float> age(count, 0.0f);
+	std::vector<float> gravity(count, 196.0f);
+	Random random;
+	random.fill(x.data(), count, 0, SCREEN_WIDTH);
+	random.fill(y.data(), count, 0, SCREEN_HEIGHT);
+	random.fill(vx.data(), count, -200, 200);
+	random.fill(vy.data(), count, -200, 200);
+
+	for (int isa = Integrator::Scalar; isa <= Integrator::getSupportedISA(); ++isa)
+	{
+		double milliseconds = timePasses([&] { Integrator::integrate(Integrator::ISA(isa), x.data(), y.data(), vx.data(), vy.data(), age.data(), gravity.data(), count, FIXED_DELTA_TIME); });
+		printf("%s: %.3f particles/ns, %.3f ms per pass over %d particles\n",
+			Integrator::getName(Integrator::ISA(isa)), count / (milliseconds * 1e6), milliseconds, count);
+	}
+
+	return 0;
+}
+
+// Sums the field of the system's particles and bodies with the tree and
+// directly, and reports how far apart they are, relative to the direct sum
+void compareNBody(ParticleSystem& system, NBodySolver::Mode mode, float theta, ThreadPool* threadPool)
+{
+	std::vector<Body*> bodies;
+	for (int i = 0; i < system.getBodyCount(); ++i)
+		bodies.push_back(system.getBody(i));
+
+	NBodySolver tree;
+	NBodySolver direct;
+	tree.setMode(mode);
+	tree.setParticleSources(true);
+	tree.setOpeningAngle(theta);
+	direct.setMode(mode);
+	direct.setParticleSources(true);
+	direct.setMethod(NBodySolver::Direct);
+	if (!tree.sumField(system.getParticles(), bodies, threadPool) || !direct.sumField(system.getParticles(), bodies, threadPool))
+		return;
+
+	double squares = 0;
+	double worst = 0;
+	int count = system.getParticleCount();
+	for (int i = 0; i < count; ++i)
+	{
+		double x = direct.getFieldX()[i];
+		double y = direct.getFieldY()[i];
+		double length = std::sqrt(x * x + y * y);
+		if (length == 0)
+			continue;
+
+		double error = std::hypot(tree.getFieldX()[i] - x, tree.getFieldY()[i] - y) / length;
+		squares += error * error;
+		worst = std::max(worst, error);
+	}
+	printf("tree against direct at theta %g over %d particles: RMS relative error %.3g, max %.3g\n",
+		theta, count, std::sqrt(squares / std::max(count, 1)), worst);
+}
+
+// Command line options, printed by --help
+const char* USAGE =
+	"Usage: ParticleSim2D [options]\n"
+	"  --seed N                 replays the run the seed was printed for\n"
+	"  --capture PREFIX         captures every frame to PREFIX plus the frame number\n"
+	"  --capture-format png|raw format of the captured frames, png by default\n"
+	"  --capture-policy drop|block\n"
+	"                           whether capture drops frames or blocks when behind,\n"
+	"                           drop by default, block headless\n"
+	"  --headless               runs without a window, drawing with the software\n"
+	"                           renderer, and reports the average frame times\n"
+	"Headless:\n"
+	"  --frames N               frames timed, 600 by default\n"
+	"  --warmup N               frames run before the timed ones, 0 by default\n"
+	"  --threads N              threads updating and drawing, one per core by default\n"
+	"  --rate N                 particles spawned per second, 20000 by default\n"
+	"  --max-particles N        particles alive at most, 200000 by default\n"
+	"  --emitters N             emitters on a grid sharing the rate and particles\n"
+	"  --lifetime X             seconds particles live, 4 by default\n"
+	"  --burst N                every emitter spawns N particles on the first frame\n"
+	"                           and none after, so they all expire together\n"
+	"  --collide N              collision passes per frame, with phase times\n"
+	"  --obstacles N            a grid of N pegs over a floor\n"
+	"  --response bounce|stick|kill|pass\n"
+	"                           what particles do when they hit obstacles\n"
+	"  --nbody gravity|electric particles and bodies pull or push each other\n"
+	"  --nbody-method tree|direct|compare\n"
+	"                           how the field is summed; compare steps with the\n"
+	"                           tree and checks the last step against direct\n"
+	"  --theta X                the tree's opening angle, 0.5 by default\n"
+	"  --fields N               N attractors and vortices, a wind and a drag\n"
+	"  --flow N|FILE.pfm        a flow field of N columns of swirls, or loaded\n"
+	"                           from a float image stretched over the screen\n"
+	"  --flow-drift             rewrites a row of the --flow N swirls every frame,\n"
+	"                           between updates, so they drift\n"
+	"  --frame-times            prints the time of every frame\n"
+	"  --no-render              only updates\n"
+	"  --output FILE.bmp        saves the last frame\n"
+	"  --bench-integrate        times the integrator on --max-particles particles,\n"
+	"                           a million by default, instead\n"
+	"  --bench-fields           times the --fields N force fields, 32 by default,\n"
+	"                           on --max-particles particles with --threads N\n"
+	"  --bench-flow             times sampling a flow field of --flow N columns,\n"
+	"                           64 by default, against gravity, instead\n";
+
+// Has the particles and bodies pull or push each other, for --nbody
+void setupNBody(ParticleSystem& system, const char* nbody, const char* method, float theta)
+{
+	NBodySolver& solver = system.getNBodySolver();
+	solver.setMode(!strcmp(nbody, "gravity") ? NBodySolver::Gravity : !strcmp(nbody, "electric") ? NBodySolver::Electrostatic : NBodySolver::Off);
+	solver.setMethod(strcmp(method, "direct") ? NBodySolver::BarnesHut : NBodySolver::Direct);
+	solver.setParticleSources(true);
+	solver.setOpeningAngle(theta);
+}
+
+// Attractors and vortices in turn on a grid, a wind and a drag, for --fields
+void setupFields(ForceField& forces, int fields)
+{
+	int columns = (int)std::ceil(std::sqrt((double)std::max(fields, 1)));
+	int rows = (fields + columns - 1) / columns;
+	for (int i = 0; i < fields; ++i)
+	{
+		Vector2 position(SCREEN_WIDTH * (i % columns + 0.5f) / columns, SCREEN_HEIGHT * (i / columns + 0.5f) / rows);
+		if (i % 2)
+			forces.addVortex(position, 20000, 20);
+		else
+			forces.addAttractor(position, 2000000, 20);
+	}
+	if (fields > 0)
+	{
+		forces.addWind(Vector2(60, 0), 0.2f);
+		forces.addDrag(0.1f);
+	}
+}
+
+// Times ForceField::apply on count particles with setupFields()'s fields,
+// spread over a pool of the given number of threads, and reports the cost
+// per particle and per field
+int benchmarkFields(int count, int fields, int threads)
+{
+	ForceField forces;
+	setupFields(forces, fields);
+	forces.prepare(FIXED_DELTA_TIME);
+
+	ParticleBuffer particles(count);
+	particles.append(count);
+	Random random;
+	int chunks = particles.getChunkCount();
+	for (int c = 0; c < chunks; ++c)
+	{
+		ParticleChunk& chunk = particles.getChunk(c);
+		int size = std::min(ParticleBuffer::CHUNK_SIZE, count - c * ParticleBuffer::CHUNK_SIZE);
+		random.fill(chunk.x, size, 0, SCREEN_WIDTH);
+		random.fill(chunk.y, size, 0, SCREEN_HEIGHT);
+		random.fill(chunk.vx, size, -200, 200);
+		random.fill(chunk.vy, size, -200, 200);
+	}
+
+	ThreadPool threadPool(threads);
+	double milliseconds = timePasses([&]
+	{
+		threadPool.run(chunks, [&](int c)
+		{
+			forces.apply(particles.getChunk(c), 0, std::min(ParticleBuffer::CHUNK_SIZE, count - c * ParticleBuffer::CHUNK_SIZE));
+		});
+	});
+	printf("%d fields, %d particles, %d threads: %.3f ms per pass, %.3f ns per particle, %.3f ns per particle and field\n",
+		forces.getFieldCount(), count, threadPool.getThreadCount(), milliseconds, milliseconds * 1e6 / count, milliseconds * 1e6 / count / std::max(forces.getFieldCount(), 1));
+	return 0;
+}
+
+// Alternating swirls a few cells across, or a field loaded from a float
+// image, for --flow
+void setupFlow(ForceField& forces, VectorField& field, const char* flow)
+{
+	if (atoi(flow) > 0)
+	{
+		int columns = atoi(flow);
+		float cellSize = (float)SCREEN_WIDTH / columns;
+		field.resize(columns, (int)std::ceil(SCREEN_HEIGHT / cellSize));
+		field.setPlacement(Vector2::Zero, cellSize);
+		for (int row = 0; row < field.getRows(); ++row)
+		{
+			for (int column = 0; column < columns; ++column)
+				field.set(column, row, Vector2(120 * std::sin(row * 0.5f), 120 * std::cos(column * 0.5f)));
+		}
+		forces.addFlow(&field, 2);
+	}
+	else if (field.load(flow))
+	{
+		field.setPlacement(Vector2::Zero, (float)SCREEN_WIDTH / field.getColumns());
+		forces.addFlow(&field, 2);
+	}
+	else
+	{
+		fprintf(stderr, "WARNING: Could not load the flow field %s!\n", flow);
+	}
+}
+
+// Rewrites one row of a field made by setupFlow() a step further along,
+// so the swirls drift a row per frame, for --flow-drift
+void driftFlow(VectorField& field, int frame, std::vector<float>& values)
+{
+	int columns = field.getColumns();
+	int row = (frame % field.getRows() + field.getRows()) % field.getRows();
+	float phase = frame * 0.05f;
+	values.resize(columns * 2);
+	for (int column = 0; column < columns; ++column)
+	{
+		values[column * 2] = 120 * std::sin(row * 0.5f + phase);
+		values[column * 2 + 1] = 120 * std::cos(column * 0.5f + phase);
+	}
+	field.update(0, row, columns, 1, values.data(), columns);
+}
+
+// Collision passes, and pegs on a grid over a floor, for --collide and
+// --obstacles; returns the response to --response
+ColliderWorld::Response setupCollisions(ParticleSystem& system, int iterations, int obstacles, const char* response)
+{
+	system.setCollisionIterations(iterations);
+
+	ColliderWorld& world = system.getColliderWorld();
+	int columns = (int)std::ceil(std::sqrt((double)std::max(obstacles, 1)));
+	int rows = (obstacles + columns - 1) / columns;
+	for (int i = 0; i < obstacles; ++i)
+		world.addCircle(Vector2(SCREEN_WIDTH * (i % columns + 0.5f) / columns, SCREEN_HEIGHT * (i / columns + 0.5f) / (rows + 1)), 4);
+	if (obstacles > 0)
+		world.addSegment(Vector2(0, SCREEN_HEIGHT - 20.0f), Vector2((float)SCREEN_WIDTH, SCREEN_HEIGHT - 20.0f));
+
+	return !strcmp(response, "stick") ? ColliderWorld::Stick : !strcmp(response, "kill") ? ColliderWorld::Kill : !strcmp(response, "pass") ? ColliderWorld::Pass : ColliderWorld::Bounce;
+}
+
+// One emitter in the middle, or a grid of them sharing the rate and
+// particles; a burst spawns all of its particles in the first step
+void setupEmitters(ParticleSystem& system, int emitters, int rate, int maxParticles, float lifetime, int burst, ColliderWorld::Response response)
+{
+	if (burst > 0)
+	{
+		rate = (int)std::ceil(burst * emitters / FIXED_DELTA_TIME) + emitters;
+		maxParticles = burst * emitters;
+	}
+
+	int columns = (int)std::ceil(std::sqrt((double)emitters));
+	int rows = (emitters + columns - 1) / columns;
+	for (int i = 0; i < emitters; ++i)
+	{
+		Vector2 position(SCREEN_WIDTH * (i % columns + 0.5f) / columns, SCREEN_HEIGHT * (i / columns + 0.5f) / rows);
+		Emitter* emitter = new Emitter(position, std::max(rate / emitters, 1), 4, lifetime, true, 10, 90, 60, 160, 220, 196, std::max(maxParticles / emitters, 1), { 0, 128, 255, 255 });
+		emitter->setEnabled(true);
+		emitter->setCollisionResponse(response);
+		system.add(new Body(emitter, position));
+	}
+}
+
+// Saves the software renderer's frame, for --output
+void saveFrame(SoftwareRenderer& renderer, const char* output)
+{
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+	SDL_Surface* surface = SDL_CreateRGBSurfaceFrom((void*)renderer.getPixels(), SCREEN_WIDTH, SCREEN_HEIGHT, 32, SCREEN_WIDTH * 4, 0xff000000, 0x00ff0000, 0x0000ff00, 0x000000ff);
+#else
+	SDL_Surface* surface = SDL_CreateRGBSurfaceFrom((void*)renderer.getPixels(), SCREEN_WIDTH, SCREEN_HEIGHT, 32, SCREEN_WIDTH * 4, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
+#endif
+	if (!surface || SDL_SaveBMP(surface, output) < 0)
+		fprintf(stderr, "WARNING: Could not save %s! SDL Error: %s\n", output, SDL_GetError());
+	SDL_FreeSurface(surface);
+}
+
+// Times VectorField::accumulate on count particles spread over a flow field
+// of the given number of columns of swirls, against integrating them with
+// plain gravity, and reports the cost per particle of each
+int benchmarkFlow(int count, int columns)
+{
+	VectorField field;
+	ForceField forces;
+	setupFlow(forces, field, std::to_string(std::max(columns, 1)).c_str());
+
+	std::vector<float> x(count);
+	std::vector<float> y(count);
+	std::vector<float> vx(count, 0.0f);
+	std::vector<float> vy(count, 0.0f);
+	std::vector<float> age(count, 0.0f);
+	std::vector<float> gravity(count, 196.0f);
+	std::vector<float> flowX(count, 0.0f);
+	std::vector<float> flowY(count, 0.0f);
+	Random random;
+	random.fill(x.data(), count, 0, SCREEN_WIDTH);
+	random.fill(y.data(), count, 0, SCREEN_HEIGHT);
+
+	// sampled first, before gravity moves the particles off the field
+	double sampleTime = timePasses([&] { field.accumulate(x.data(), y.data(), count, 1, flowX.data(), flowY.data()); });
+	double gravityTime = timePasses([&] { Integrator::integrate(x.data(), y.data(), vx.data(), vy.data(), age.data(), gravity.data(), count, FIXED_DELTA_TIME); });
+	printf("%dx%d flow field, %d particles: gravity %.3f ns, sample %.3f ns per particle, %.2f times gravity\n",
+		field.getColumns(), field.getRows(), count, gravityTime * 1e6 / count, sampleTime * 1e6 / count, sampleTime / gravityTime);
+	return 0;
+}
+
+// Frame and phase times of the headless runner, summed over the timed frames
+struct HeadlessTimes
+{
+	double update = 0;
+	double render = 0;
+	double worstUpdate = 0;
+	double worstRender = 0;
+	double broadphase = 0;
+	double narrowphase = 0;
+	double writeBack = 0;
+	long long contacts = 0;
+	double tree = 0;
+	double field = 0;
+
+	void add(ParticleSystem& system, double updateTime, double renderTime)
+	{
+		ParticleCollider::Timings timings = system.getCollisionTimings();
+		broadphase += timings.broadphase;
+		narrowphase += timings.narrowphase;
+		writeBack += timings.writeBack;
+		contacts += timings.contacts;
+		tree += system.getNBodySolver().getTimings().build;
+		field += system.getNBodySolver().getTimings().field;
+		update += updateTime;
+		render += renderTime;
+		worstUpdate = std::max(worstUpdate, updateTime);
+		worstRender = std::max(worstRender, renderTime);
+	}
+
+	void report(ParticleSystem& system, int frames, int emitters, int threads, int collisions, const char* nbody)
+	{
+		printf("%d frames, %d emitters, %d particles, %d threads: update %.3f ms, %.3f ms worst, render %.3f ms, %.3f ms worst\n",
+			frames, emitters, system.getParticleCount(), threads, update * 1000 / frames, worstUpdate * 1000, render * 1000 / frames, worstRender * 1000);
+		if (collisions > 0)
+			printf("%d collision passes: broadphase %.3f ms, narrowphase %.3f ms, write back %.3f ms, %lld contacts\n",
+				collisions, broadphase / frames, narrowphase / frames, writeBack / frames, contacts / frames);
+		NBodySolver& solver = system.getNBodySolver();
+		if (solver.getMode() != NBodySolver::Off)
+			printf("%s %s: build %.3f ms, field %.3f ms\n",
+				nbody, solver.getMethod() == NBodySolver::Direct ? "direct" : "tree", tree / frames, field / frames);
+	}
 };
 
+// Runs the simulation without a window or GL context, drawing every frame
+// with the software renderer, and reports the average frame times; see
+// USAGE for the options
+int runHeadless(int argc, char* args[])
+{
+	if (hasOption(argc, args, "--bench-integrate"))
+		return benchmarkIntegrator(std::max(atoi(getOption(argc, args, "--max-particles", "1000000")), 1));
+	if (hasOption(argc, args, "--bench-fields"))
+		return benchmarkFields(std::max(atoi(getOption(argc, args, "--max-particles", "1000000")), 1), atoi(getOption(argc, args, "--fields", "32")),
+			std::max(atoi(getOption(argc, args, "--threads", "0")), 0));
+	if (hasOption(argc, args, "--bench-flow"))
+		return benchmarkFlow(std::max(atoi(getOption(argc, args, "--max-particles", "1000000")), 1), atoi(getOption(argc, args, "--flow", "64")));
+
+	int frames = atoi(getOption(argc, args, "--frames", "600"));
+	int warmup = std::max(atoi(getOption(argc, args, "--warmup", "0")), 0);
+	int threads = std::max(atoi(getOption(argc, args, "--threads", "0")), 0);
+	int rate = atoi(getOption(argc, args, "--rate", "20000"));
+	int maxParticles = atoi(getOption(argc, args, "--max-particles", "200000"));
+	int emitters = std::max(atoi(getOption(argc, args, "--emitters", "1")), 1);
+	float lifetime = (float)atof(getOption(argc, args, "--lifetime", "4"));
+	int burst = atoi(getOption(argc, args, "--burst", "0"));
+	int collisions = atoi(getOption(argc, args, "--collide", "0"));
+	int obstacles = atoi(getOption(argc, args, "--obstacles", "0"));
+	const char* response = getOption(argc, args, "--response", "bounce");
+	const char* nbody = getOption(argc, args, "--nbody", "off");
+	const char* nbodyMethod = getOption(argc, args, "--nbody-method", "tree");
+	float theta = (float)atof(getOption(argc, args, "--theta", "0.5"));
+	int fields = atoi(getOption(argc, args, "--fields", "0"));
+	const char* flow = getOption(argc, args, "--flow");
+	bool flowDrift = flow && atoi(flow) > 0 && hasOption(argc, args, "--flow-drift");
+	bool frameTimes = hasOption(argc, args, "--frame-times");
+	bool render = !hasOption(argc, args, "--no-render");
+	const char* output = getOption(argc, args, "--output");
+
+	if (SDL_Init(SDL_INIT_TIMER) < 0)
+		error("SDL could not initialize! SDL Error: %s\n", SDL_GetError());
+
+	// the force field refers to the flow field, which has to outlive it
+	VectorField flowField;
+	ThreadPool threadPool(threads);
+	SoftwareRenderer renderer(SCREEN_WIDTH, SCREEN_HEIGHT, &threadPool);
+	ParticleSystem system(SCREEN_WIDTH, SCREEN_HEIGHT);
+	system.setThreadPool(&threadPool);
+	system.setVertexFormat(renderer.getVertexFormat());
+	setupNBody(system, nbody, nbodyMethod, theta);
+	setupFields(system.getForceField(), fields);
+	if (flow)
+		setupFlow(system.getForceField(), flowField, flow);
+	ColliderWorld::Response collisionResponse = setupCollisions(system, collisions, obstacles, response);
+	setupEmitters(system, emitters, rate, maxParticles, lifetime, burst, collisionResponse);
+	FrameCapture* capture = createCapture(argc, args, FrameCapture::Block);
+
+	const SDL_Color background = { 51, 51, 51, 255 };
+	HeadlessTimes times;
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+	std::vector<float> flowRow;
+	for (int frame = -warmup; frame < frames; ++frame)
+	{
+		Uint64 start = SDL_GetPerformanceCounter();
+		// the field only changes between updates, on the thread running them
+		if (flowDrift)
+			driftFlow(flowField, frame, flowRow);
+		system.update(FIXED_DELTA_TIME);
+		Uint64 updated = SDL_GetPerformanceCounter();
+		if (render)
+		{
+			renderer.clear(background);
+			system.render(renderer);
+			if (capture)
+				capture->capture(renderer.getPixels());
+		}
+		Uint64 rendered = SDL_GetPerformanceCounter();
+
+		// warmup frames aren't counted
+		if (frame >= 0)
+			times.add(system, double(updated - start) / frequency, double(rendered - updated) / frequency);
+		if (frameTimes)
+			printf("frame %d: update %.3f ms, render %.3f ms, %d particles\n",
+				frame, double(updated - start) * 1000 / frequency, double(rendered - updated) * 1000 / frequency, system.getParticleCount());
+
+		if (burst > 0 && frame == -warmup)
+		{
+			for (int i = 0; i < system.getEmitterCount(); ++i)
+				system.getEmitter(i)->setEnabled(false);
+		}
+	}
+
+	if (frames > 0)
+		times.report(system, frames, emitters, threadPool.getThreadCount(), collisions, nbody);
+	if (!strcmp(nbodyMethod, "compare"))
+		compareNBody(system, system.getNBodySolver().getMode(), theta, &threadPool);
+	finishCapture(capture);
+
+	if (output)
+		saveFrame(renderer, output);
+
+	SDL_Quit();
+	return 0;
+}
+
 int main(int argc, char* args[])
 {
     // atexit(pause);
-    std::randomize();
+
+	if (hasOption(argc, args, "--help"))
+	{
+		printf("%s", USAGE);
+		return 0;
+	}
+
+	// --seed N replays the run the seed was printed for
+	const char* seed = getOption(argc, args, "--seed");
+	char* seedEnd = nullptr;
+	unsigned long long seedValue = seed ? strtoull(seed, &seedEnd, 10) : 0;
+	if (seed && (seedEnd == seed || *seedEnd || *seed == '-'))
+	{
+		fprintf(stderr, "WARNING: Invalid seed %s!\n", seed);
+		seed = nullptr;
+	}
+
+	if (seed)
+		std::randomize(seedValue);
+	else
+		std::randomize();
+	printf("Seed %llu\n", (unsigned long long)Random::getMasterSeed());
+
+	if (hasOption(argc, args, "--headless"))
+		return runHeadless(argc, args);
 
 	// SDL
 	SDL_Window* sdlWindow = NULL;
@@ -278,6 +997,7 @@ int main(int argc, char* args[])
 
 	// Create GL Context
 	SDL_GLContext context = SDL_GL_CreateContext(sdlWindow);
+	GLFunctions::load();
 
 	// Set background color
 	glClearColor(0.2, 0.2, 0.2, 1);
@@ -290,6 +1010,7 @@ int main(int argc, char* args[])
 	nanogui::init();
 
 	Simulation* simulation = new Simulation("Particle Sim 2D", sdlWindow, SCREEN_WIDTH, SCREEN_HEIGHT);
+	FrameCapture* capture = createCapture(argc, args, FrameCapture::Drop);
 
 	// Disable depth testing (because we're working in 2D!)
 	glDisable(GL_DEPTH_TEST);
@@ -301,9 +1022,9 @@ int main(int argc, char* args[])
     // Loop control
 	uint32_t last = SDL_GetTicks();
     bool terminated = false;
+	bool idle = false;
 	float fpsElapsedTime = 0;
 	int fpsFrameCount = 0;
-	float elapsedTime = 0;
 	try
 	{
 		while (!terminated)
@@ -313,11 +1034,8 @@ int main(int argc, char* args[])
 			float deltaTime = float(now - last) / 1000;
 			last = now;
 
-			elapsedTime += deltaTime;
-			for (;elapsedTime >= FIXED_DELTA_TIME; elapsedTime -= FIXED_DELTA_TIME)
-			{
-				simulation->update(FIXED_DELTA_TIME);
-			}
+			// the simulation steps on its own thread
+			simulation->update();
 
 			fpsElapsedTime += deltaTime;
 			fpsFrameCount++;
@@ -328,10 +1046,13 @@ int main(int argc, char* args[])
 				fpsElapsedTime = 0;
 			}
 
-			// Handle Input
+			// Handle Input; with nothing moving, block until something happens
 			SDL_Event e;
-			while (SDL_PollEvent(&e) != 0)
+			bool handled = false;
+			bool pending = (idle ? SDL_WaitEventTimeout(&e, IDLE_TIMEOUT) : SDL_PollEvent(&e)) != 0;
+			while (pending)
 			{
+				handled = true;
 				switch (e.type)
 				{
 				case SDL_QUIT:
@@ -341,14 +1062,22 @@ int main(int argc, char* args[])
 
 				// Update Simulation
 				simulation->handle_event(e);
+				pending = SDL_PollEvent(&e) != 0;
 			}		
 
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 			simulation->render();
 
+			if (capture)
+				capture->capture();
+
 			//Update screen
 			SDL_GL_SwapWindow(sdlWindow);
+
+			idle = !handled && !capture && simulation->isIdle();
+			if (!idle)
+				simulation->waitForNextFrame();
 		}
 	}
 	catch (const std::runtime_error &e)
@@ -361,6 +1090,7 @@ int main(int argc, char* args[])
 		#endif
 	}
 
+	finishCapture(capture);
 	delete simulation;
 
 	nanogui::shutdown();